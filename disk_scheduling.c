@@ -22,22 +22,72 @@
  *   • Actual service order for each algorithm
  *   • Total head movement (in cylinders)
  *
+ * An optional MODE argument after the direction selects an
+ * analysis instead of the six-algorithm report:
+ *   WINDOW <i> <j>   O(1) window totals for FCFS and the sweeps
+ *   SLIDE <W>        totals for every window of the last W requests
+ *   VR [steps]       V(R) and grouped SSTF movement/wait frontier
+ *   BEAM <k> <b>     beam-search look-ahead vs SSTF and optimal
+ *   ANNEAL <w> <s>   movement + lateness optimizer (annealing)
+ *   ORDER <B> <F> <D> cost of barrier/FUA/dependency constraints
+ *   BG <kind> <every> foreground latency under scrub/rebuild I/O
+ *   CLOSED <N>       closed-loop clients: throughput/latency vs N
+ *   FIO <job file>   requests generated from fio job definitions
+ *   BLKMQ <cpus> <N> single-queue vs blk-mq lock contention
+ *   ZBR [sectors]    zoned seek + rotation + transfer service model
+ *   PLACE <kind>     organ-pipe / hot-data relocation from the trace
+ *   REARR [band]     online hot-cylinder migration into a central band
+ *   DEFECT <kind> <d> grown-defect remapping on an aging fleet
+ *   TIER <job> <MiB> write-back SSD cache tier in front of the HDD
+ *   TAPE <batch>     serpentine tape locate model and recall ordering
+ *   SURFACE [ms]     head-switch cost and surface-aware ordering
+ *   SUBMIT <P>       lock-free multi-producer submission throughput
+ *   BENCH [n]        large-array placement, queue prefetch distance
+ * The simulator modes (BG, CLOSED, FIO, ZBR, REARR, TIER, SURFACE) report
+ * the online-only DEADLINE and KYBER policies.
+ *
  * Design:
  *   Algorithms producing monotonic sweeps (SCAN, LOOK variants)
  *   operate on a sorted request array. FCFS and SSTF use the
  *   original ordering. Head movement is computed generically.
  ***************************************************************/
 
+#define _GNU_SOURCE   // pthread_setaffinity_np, MAP_HUGETLB, MADV_HUGEPAGE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <stddef.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
 
 #define NUM_CYLINDERS 300
 #define NUM_REQUESTS  20
 
 typedef enum { DIR_LEFT, DIR_RIGHT } Direction;
 
+typedef enum {
+    ALG_FCFS, ALG_SSTF, ALG_SCAN, ALG_CSCAN, ALG_LOOK, ALG_CLOOK,
+    NUM_ALGS,
+    // online-only policies, available in the simulator modes
+    ALG_DEADLINE = NUM_ALGS, ALG_KYBER,
+    NUM_ONLINE_ALGS
+} Algorithm;
+
+const char *ALG_NAMES[NUM_ONLINE_ALGS] = {
+    "FCFS", "SSTF", "SCAN", "C-SCAN", "LOOK", "C-LOOK",
+    "DEADLINE", "KYBER"
+};
+
 /****************************************************************
  * parse_direction
  * Converts a direction argument into an enum.
@@ -76,6 +126,410 @@ int compute_movement(int seq[], int len, int start) {
     return total;
 }
 
+/****************************************************************
+ * build_prefix
+ * Builds the FCFS prefix-sum index of a trace:
+ *   prefix[k] = sum of |req[m] - req[m-1]| for 0 < m <= k
+ * Built once per trace. 64-bit so long traces cannot overflow.
+ ****************************************************************/
+void build_prefix(int req[], int n, long long prefix[]) {
+    prefix[0] = 0;
+    for (int k = 1; k < n; k++)
+        prefix[k] = prefix[k - 1] + abs(req[k] - req[k - 1]);
+}
+
+/****************************************************************
+ * fcfs_window_movement
+ * FCFS head movement for servicing req[i..j) from start, in O(1)
+ * using the prefix-sum index instead of rescanning the window.
+ ****************************************************************/
+long long fcfs_window_movement(int req[], long long prefix[],
+                               int i, int j, int start) {
+    if (i >= j) return 0;
+    return abs(req[i] - start) + prefix[j - 1] - prefix[i];
+}
+
+/****************************************************************
+ * CylSet
+ * Bitset over all cylinders. Unions are a handful of word ORs,
+ * and min/max/predecessor/successor are word scans, so every
+ * operation is constant time for a fixed disk geometry.
+ ****************************************************************/
+#define CYL_WORDS ((NUM_CYLINDERS + 63) / 64)
+
+typedef struct {
+    unsigned long long w[CYL_WORDS];
+} CylSet;
+
+void cylset_add(CylSet *s, int cyl) {
+    s->w[cyl / 64] |= 1ULL << (cyl % 64);
+}
+
+void cylset_remove(CylSet *s, int cyl) {
+    s->w[cyl / 64] &= ~(1ULL << (cyl % 64));
+}
+
+CylSet cylset_union(const CylSet *a, const CylSet *b) {
+    CylSet u;
+    for (int k = 0; k < CYL_WORDS; k++)
+        u.w[k] = a->w[k] | b->w[k];
+    return u;
+}
+
+/* Largest member < cyl, or -1 if none. */
+int cylset_pred(const CylSet *s, int cyl) {
+    if (cyl <= 0) return -1;
+    int k = (cyl - 1) / 64;
+    int bit = (cyl - 1) % 64;
+    unsigned long long w = s->w[k] & (~0ULL >> (63 - bit));
+
+    for (;;) {
+        if (w) return k * 64 + 63 - __builtin_clzll(w);
+        if (--k < 0) return -1;
+        w = s->w[k];
+    }
+}
+
+/* Smallest member >= cyl, or -1 if none. */
+int cylset_succ(const CylSet *s, int cyl) {
+    if (cyl >= NUM_CYLINDERS) return -1;
+    int k = cyl / 64;
+    unsigned long long w = s->w[k] & (~0ULL << (cyl % 64));
+
+    for (;;) {
+        if (w) return k * 64 + __builtin_ctzll(w);
+        if (++k >= CYL_WORDS) return -1;
+        w = s->w[k];
+    }
+}
+
+/****************************************************************
+ * WindowShape
+ * Everything the sweep algorithms depend on for a window of
+ * requests, relative to the start position:
+ *   - lo/hi: smallest and largest requested cylinder
+ *   - below: largest request < start (-1 if none)
+ *   - above: smallest request >= start (-1 if none)
+ ****************************************************************/
+typedef struct {
+    int lo, hi;
+    int below, above;
+} WindowShape;
+
+WindowShape cylset_shape(const CylSet *s, int start) {
+    WindowShape w;
+    w.lo = cylset_succ(s, 0);
+    w.hi = cylset_pred(s, NUM_CYLINDERS);
+    w.below = cylset_pred(s, start);
+    w.above = cylset_succ(s, start);
+    return w;
+}
+
+/****************************************************************
+ * shape_movement
+ * Closed-form head movement of a sweep algorithm over a window.
+ * Sweeps are monotonic between turning points, so movement only
+ * depends on the few waypoints where the head turns or wraps;
+ * those are fed to compute_movement. Returns -1 for FCFS/SSTF,
+ * which depend on the full request order.
+ ****************************************************************/
+int shape_movement(WindowShape w, Algorithm alg, int start,
+                   Direction dir) {
+    int way[4];
+    int n = 0;
+    int hasBelow = w.below >= 0;
+    int hasAbove = w.above >= 0;
+
+    switch (alg) {
+    case ALG_SCAN:
+        if (dir == DIR_LEFT) {
+            way[n++] = 0;
+            if (hasAbove) way[n++] = w.hi;
+        } else {
+            way[n++] = NUM_CYLINDERS - 1;
+            if (hasBelow) way[n++] = w.lo;
+        }
+        break;
+    case ALG_CSCAN:
+        if (dir == DIR_RIGHT) {
+            way[n++] = NUM_CYLINDERS - 1;
+            way[n++] = 0;
+            if (hasBelow) way[n++] = w.below;
+        } else {
+            way[n++] = 0;
+            way[n++] = NUM_CYLINDERS - 1;
+            if (hasAbove) way[n++] = w.above;
+        }
+        break;
+    case ALG_LOOK:
+        if (dir == DIR_LEFT) {
+            if (hasBelow) way[n++] = w.lo;
+            if (hasAbove) way[n++] = w.hi;
+        } else {
+            if (hasAbove) way[n++] = w.hi;
+            if (hasBelow) way[n++] = w.lo;
+        }
+        break;
+    case ALG_CLOOK:
+        if (dir == DIR_RIGHT) {
+            if (hasAbove) way[n++] = w.hi;
+            if (hasBelow) { way[n++] = w.lo; way[n++] = w.below; }
+        } else {
+            if (hasBelow) way[n++] = w.lo;
+            if (hasAbove) { way[n++] = w.hi; way[n++] = w.above; }
+        }
+        break;
+    default:
+        return -1;
+    }
+    return compute_movement(way, n, start);
+}
+
+/****************************************************************
+ * TraceIndex
+ * Per-trace indexes for O(1) window queries:
+ *   - prefix: FCFS prefix sums (see build_prefix)
+ *   - sparse: sparse table of cylinder sets, where sparse[k][i]
+ *     holds the cylinders of req[i .. i + 2^k). Any window is
+ *     the union of two overlapping power-of-two blocks.
+ ****************************************************************/
+#define RMQ_LEVELS 5
+_Static_assert((1 << RMQ_LEVELS) > NUM_REQUESTS,
+               "RMQ_LEVELS too small for NUM_REQUESTS");
+
+typedef struct {
+    long long prefix[NUM_REQUESTS];
+    CylSet sparse[RMQ_LEVELS][NUM_REQUESTS];
+} TraceIndex;
+
+void build_trace_index(int req[], TraceIndex *ti) {
+    build_prefix(req, NUM_REQUESTS, ti->prefix);
+
+    memset(ti->sparse[0], 0, sizeof(ti->sparse[0]));
+    for (int i = 0; i < NUM_REQUESTS; i++)
+        cylset_add(&ti->sparse[0][i], req[i]);
+
+    for (int k = 1; k < RMQ_LEVELS; k++)
+        for (int i = 0; i + (1 << k) <= NUM_REQUESTS; i++)
+            ti->sparse[k][i] = cylset_union(
+                &ti->sparse[k - 1][i],
+                &ti->sparse[k - 1][i + (1 << (k - 1))]);
+}
+
+/****************************************************************
+ * window_cylinders
+ * Cylinder set of req[i..j), from two sparse-table blocks.
+ ****************************************************************/
+CylSet window_cylinders(const TraceIndex *ti, int i, int j) {
+    int k = 31 - __builtin_clz(j - i);
+    return cylset_union(&ti->sparse[k][i],
+                        &ti->sparse[k][j - (1 << k)]);
+}
+
+/****************************************************************
+ * CylTree
+ * Fenwick tree of request counts per cylinder: an order-statistic
+ * multiset of the queued cylinders with O(log C) insert, delete,
+ * rank and select. Indexes are 1-based internally.
+ ****************************************************************/
+#define FENWICK_TOP 256   // largest power of two <= NUM_CYLINDERS
+
+typedef struct {
+    int tree[NUM_CYLINDERS + 1];
+    int count;
+} CylTree;
+
+void cyltree_add(CylTree *t, int cyl, int delta) {
+    t->count += delta;
+    for (int i = cyl + 1; i <= NUM_CYLINDERS; i += i & -i)
+        t->tree[i] += delta;
+}
+
+/* Number of queued requests on cylinders < cyl. */
+int cyltree_rank(const CylTree *t, int cyl) {
+    int sum = 0;
+    for (int i = cyl; i > 0; i -= i & -i)
+        sum += t->tree[i];
+    return sum;
+}
+
+/* Cylinder of the k-th smallest queued request (1-based). */
+int cyltree_select(const CylTree *t, int k) {
+    int pos = 0;
+    for (int step = FENWICK_TOP; step > 0; step >>= 1) {
+        if (pos + step <= NUM_CYLINDERS && t->tree[pos + step] < k) {
+            pos += step;
+            k -= t->tree[pos];
+        }
+    }
+    return pos;   // 1-based pos + 1, minus 1 for the cylinder
+}
+
+/* Largest queued cylinder < cyl, or -1 if none. */
+int cyltree_pred(const CylTree *t, int cyl) {
+    int r = cyltree_rank(t, cyl);
+    return r > 0 ? cyltree_select(t, r) : -1;
+}
+
+/* Smallest queued cylinder >= cyl, or -1 if none. */
+int cyltree_succ(const CylTree *t, int cyl) {
+    int r = cyltree_rank(t, cyl);
+    return r < t->count ? cyltree_select(t, r + 1) : -1;
+}
+
+WindowShape cyltree_shape(const CylTree *t, int start) {
+    WindowShape w;
+    w.lo = cyltree_select(t, 1);
+    w.hi = cyltree_select(t, t->count);
+    w.below = cyltree_pred(t, start);
+    w.above = cyltree_succ(t, start);
+    return w;
+}
+
+/****************************************************************
+ * cyltree_sstf
+ * SSTF movement over the queued requests, using predecessor and
+ * successor queries instead of a linear scan per step. Requests
+ * on the same cylinder are drained together (distance 0). Ties
+ * go to the cylinder holding the earliest arrival, first[c],
+ * matching schedule_sstf. The tree is restored before returning.
+ ****************************************************************/
+int cyltree_sstf(CylTree *t, const int first[], int start) {
+    int undoCyl[NUM_REQUESTS];
+    int undoCnt[NUM_REQUESTS];
+    int undo = 0;
+    int head = start;
+    int total = 0;
+
+    while (t->count > 0) {
+        int b = cyltree_pred(t, head);
+        int a = cyltree_succ(t, head);
+        int next;
+
+        if (b < 0) next = a;
+        else if (a < 0) next = b;
+        else if (head - b != a - head) next = head - b < a - head ? b : a;
+        else next = first[b] < first[a] ? b : a;
+
+        int m = cyltree_rank(t, next + 1) - cyltree_rank(t, next);
+        cyltree_add(t, next, -m);
+        undoCyl[undo] = next;
+        undoCnt[undo++] = m;
+
+        total += abs(next - head);
+        head = next;
+    }
+
+    while (undo-- > 0)
+        cyltree_add(t, undoCyl[undo], undoCnt[undo]);
+    return total;
+}
+
+/****************************************************************
+ * fnv1a
+ * 64-bit FNV-1a, continued from h over len bytes.
+ ****************************************************************/
+#define FNV_OFFSET 1469598103934665603ULL
+
+unsigned long long fnv1a(unsigned long long h, const void *data,
+                         size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ p[i]) * 1099511628211ULL;
+    return h;
+}
+
+/****************************************************************
+ * trace_hash
+ * Hash of the request bytes and the disk geometry. Keys the
+ * on-disk caches, so a different trace or a rebuilt binary with
+ * another geometry never sees stale entries.
+ ****************************************************************/
+unsigned long long trace_hash(int req[]) {
+    int geometry[2] = { NUM_CYLINDERS, NUM_REQUESTS };
+    unsigned long long h = fnv1a(FNV_OFFSET, geometry, sizeof(geometry));
+    return fnv1a(h, req, NUM_REQUESTS * sizeof(int));
+}
+
+/****************************************************************
+ * Sorted-index sidecar
+ * The sorted request array is cached as
+ *   <cache dir>/sorted-<trace hash>.bin
+ * laid out as a SidecarHeader followed by the sorted requests.
+ * Files are written to a temporary name and renamed into place,
+ * so readers only ever see complete sidecars.
+ ****************************************************************/
+#define SIDECAR_MAGIC "DSSORT1"
+
+typedef struct {
+    char magic[8];
+    unsigned long long hash;
+    int cylinders;
+    int requests;
+} SidecarHeader;
+
+void sidecar_path(char *path, size_t size, const char *dir,
+                  unsigned long long hash) {
+    snprintf(path, size, "%s/sorted-%016llx.bin", dir, hash);
+}
+
+/****************************************************************
+ * load_sorted_sidecar
+ * Fills sorted[] from the sidecar for this trace hash.
+ * Returns 1 on success, 0 if missing, stale or corrupt.
+ ****************************************************************/
+int load_sorted_sidecar(const char *dir, unsigned long long hash,
+                        int sorted[]) {
+    char path[512];
+    sidecar_path(path, sizeof(path), dir, hash);
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return 0;
+
+    SidecarHeader h;
+    int ok = fread(&h, sizeof(h), 1, fp) == 1
+          && memcmp(h.magic, SIDECAR_MAGIC, sizeof(h.magic)) == 0
+          && h.hash == hash
+          && h.cylinders == NUM_CYLINDERS
+          && h.requests == NUM_REQUESTS
+          && fread(sorted, sizeof(int), NUM_REQUESTS, fp) == NUM_REQUESTS;
+    fclose(fp);
+
+    for (int i = 1; ok && i < NUM_REQUESTS; i++)
+        if (sorted[i - 1] > sorted[i]) ok = 0;
+    return ok;
+}
+
+/****************************************************************
+ * save_sorted_sidecar
+ * Writes the sidecar for this trace hash. Failures are ignored:
+ * the cache is an optimization, not part of the result.
+ ****************************************************************/
+void save_sorted_sidecar(const char *dir, unsigned long long hash,
+                         int sorted[]) {
+    char path[512], tmp[540];
+    sidecar_path(path, sizeof(path), dir, hash);
+    // per-process name: concurrent writers never share a temp file
+    snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long)getpid());
+
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) return;
+
+    SidecarHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SIDECAR_MAGIC, sizeof(h.magic));
+    h.hash = hash;
+    h.cylinders = NUM_CYLINDERS;
+    h.requests = NUM_REQUESTS;
+
+    int ok = fwrite(&h, sizeof(h), 1, fp) == 1
+          && fwrite(sorted, sizeof(int), NUM_REQUESTS, fp) == NUM_REQUESTS;
+    if (fclose(fp) != 0) ok = 0;
+
+    if (!ok || rename(tmp, path) != 0)
+        remove(tmp);
+}
+
 /****************************************************************
  * Struct representing the result of a scheduling algorithm:
  *   - seq: serviced request order
@@ -276,72 +730,5474 @@ Result schedule_clook(int sorted[], int start, Direction dir) {
 }
 
 /****************************************************************
- * print_result
- * Prints sequence and total movement in the required format.
+ * SortedReq
+ * A request tagged with its arrival index, sorted by cylinder
+ * (then arrival). The continuum schedulers below work on this
+ * array: on a line the serviced set of a nearest-neighbour policy
+ * is always a contiguous run of it, so the nearest pending
+ * request on either side is just the next element past a
+ * left/right cursor - O(1) per step, O(n) per schedule.
  ****************************************************************/
-void print_result(const char *name, Result r) {
-    printf("%s DISK SCHEDULING ALGORITHM:\n\n", name);
+typedef struct {
+    int cyl;
+    int idx;
+} SortedReq;
 
-    for (int i = 0; i < r.len; i++) {
-        printf("%d", r.seq[i]);
-        if (i < r.len - 1) printf(", ");
+int cmp_sorted_req(const void *a, const void *b) {
+    const SortedReq *x = (const SortedReq *)a;
+    const SortedReq *y = (const SortedReq *)b;
+    if (x->cyl != y->cyl) return (x->cyl > y->cyl) - (x->cyl < y->cyl);
+    return (x->idx > y->idx) - (x->idx < y->idx);
+}
+
+void sort_requests(int req[], int n, SortedReq out[]) {
+    for (int i = 0; i < n; i++) {
+        out[i].cyl = req[i];
+        out[i].idx = i;
     }
+    qsort(out, n, sizeof(SortedReq), cmp_sorted_req);
+}
 
-    printf("\n\n%s - Total head movements = %d\n\n",
-           name, r.movement);
+/* First sorted position in [a, b) with cylinder >= cyl. */
+int sorted_req_index(const SortedReq s[], int a, int b, int cyl) {
+    while (a < b && s[a].cyl < cyl) a++;
+    return a;
 }
 
 /****************************************************************
- * main
- * Coordinates:
- *    argument parsing
- *    file I/O for request.bin
- *    sorting
- *    invocation of all algorithms
+ * V(R) - continuum between SSTF and SCAN
+ * Picks the nearest pending request, but charges R * disk size
+ * extra for reversing direction. V(0) is SSTF; V(1) never
+ * reverses while requests remain ahead, i.e. LOOK.
+ * Fills order[] with arrival indices in service order.
  ****************************************************************/
-int main(int argc, char *argv[]) {
-    if (argc != 3) {
-        fprintf(stderr, "Usage: ./A4Q1 <initial> <LEFT|RIGHT>\n");
-        return 1;
+void schedule_vr(const SortedReq s[], int n, int start, Direction dir,
+                 double r, int order[]) {
+    double bias = r * NUM_CYLINDERS;
+    int right = sorted_req_index(s, 0, n, start);
+    int left = right - 1;
+    int head = start;
+
+    for (int k = 0; k < n; k++) {
+        double dL = left >= 0 ? head - s[left].cyl : 1e18;
+        double dR = right < n ? s[right].cyl - head : 1e18;
+        if (dir == DIR_RIGHT) dL += bias;
+        else dR += bias;
+
+        int goRight = dR < dL || (dR == dL && dir == DIR_RIGHT);
+        int p = goRight ? right++ : left--;
+
+        if (s[p].cyl != head)
+            dir = s[p].cyl > head ? DIR_RIGHT : DIR_LEFT;
+        head = s[p].cyl;
+        order[k] = s[p].idx;
     }
+}
 
-    int start = atoi(argv[1]);
-    if (start < 0 || start >= NUM_CYLINDERS) {
-        fprintf(stderr, "ERROR: Initial head must be between 0 and 299.\n");
-        return 1;
+/****************************************************************
+ * Grouped SSTF
+ * Cylinders are split into groups of `group` cylinders. Groups
+ * are visited in LOOK order from the start's group; SSTF runs
+ * within each group. group = 1 behaves like LOOK, and a group
+ * spanning the whole disk is plain SSTF.
+ ****************************************************************/
+void schedule_grouped_sstf(const SortedReq s[], int n, int start,
+                           Direction dir, int group, int order[]) {
+    int numGroups = (NUM_CYLINDERS + group - 1) / group;
+    int g0 = start / group;
+    int head = start;
+    int k = 0;
+
+    for (int step = 0; step < numGroups; step++) {
+        // LOOK order over groups: g0 and onward in dir, then back
+        int ahead = dir == DIR_LEFT ? g0 : numGroups - 1 - g0;
+        int g;
+        if (step <= ahead)
+            g = dir == DIR_LEFT ? g0 - step : g0 + step;
+        else
+            g = dir == DIR_LEFT ? g0 + step - ahead : g0 - step + ahead;
+
+        int a = sorted_req_index(s, 0, n, g * group);
+        int b = sorted_req_index(s, a, n, (g + 1) * group);
+
+        // two-cursor SSTF within [a, b)
+        int right = sorted_req_index(s, a, b, head);
+        int left = right - 1;
+        while (left >= a || right < b) {
+            int dL = left >= a ? head - s[left].cyl : NUM_CYLINDERS;
+            int dR = right < b ? s[right].cyl - head : NUM_CYLINDERS;
+            int p = (dR < dL || (dR == dL && dir == DIR_RIGHT))
+                    ? right++ : left--;
+            head = s[p].cyl;
+            order[k++] = s[p].idx;
+        }
     }
+}
 
-    Direction dir = parse_direction(argv[2]);
+/****************************************************************
+ * order_stats
+ * Movement and fairness of a service order (arrival indices).
+ * Wait is measured in service slots past arrival position, so
+ * FCFS has zero wait and heavy reordering shows up as large max.
+ ****************************************************************/
+typedef struct {
+    int movement;
+    int max_wait;
+} OrderStats;
 
-    int req[NUM_REQUESTS];
-    FILE *fp = fopen("request.bin", "rb");
-    if (!fp) {
-        perror("ERROR opening request.bin");
-        return 1;
+OrderStats order_stats(int req[], const int order[], int n, int start) {
+    OrderStats st = { 0, 0 };
+    int head = start;
+
+    for (int k = 0; k < n; k++) {
+        st.movement += abs(req[order[k]] - head);
+        head = req[order[k]];
+        if (k - order[k] > st.max_wait)
+            st.max_wait = k - order[k];
     }
+    return st;
+}
 
-    if (fread(req, sizeof(int), NUM_REQUESTS, fp) != NUM_REQUESTS) {
-        fprintf(stderr, "ERROR: Could not read all requests.\n");
-        return 1;
+/****************************************************************
+ * optimal_movement
+ * Offline optimum for requests known up front: on a line the
+ * best order sweeps to one extreme and then to the other, so the
+ * optimum is the cheaper of "nearest end first" and its mirror.
+ ****************************************************************/
+int optimal_movement(int req[], int n, int start) {
+    int lo = start, hi = start;
+    for (int i = 0; i < n; i++) {
+        if (req[i] < lo) lo = req[i];
+        if (req[i] > hi) hi = req[i];
     }
-    fclose(fp);
+    int span = hi - lo;
+    int nearEnd = start - lo < hi - start ? start - lo : hi - start;
+    return span + nearEnd;
+}
 
-    int sorted[NUM_REQUESTS];
-    memcpy(sorted, req, sizeof(req));
-    qsort(sorted, NUM_REQUESTS, sizeof(int), cmp_int);
+/****************************************************************
+ * Beam search look-ahead
+ * At every step, expands the pending requests k levels deep,
+ * keeping only the b best partial paths per level, and then
+ * commits the first move of the best path. Paths are ranked by
+ * movement so far plus the movement still needed from the path's
+ * head to cover the requests left over.
+ *
+ * Nodes come from a fixed pool reused by every step, so the
+ * search does no allocation. The visited set is a bitmask.
+ ****************************************************************/
+#define MAX_BEAM 64
+_Static_assert(NUM_REQUESTS <= 64, "beam masks hold 64 requests");
 
-    printf("Total requests = %d\n", NUM_REQUESTS);
-    printf("Initial Head Position: %d\n", start);
-    printf("Direction of Head: %s\n\n",
-           dir == DIR_LEFT ? "LEFT" : "RIGHT");
+typedef struct {
+    unsigned long long visited;
+    int head;
+    int cost;     // movement along the path
+    int score;    // cost plus the movement still needed
+    int first;    // arrival index of the first move on this path
+} BeamNode;
+
+typedef struct {
+    BeamNode level[2][MAX_BEAM * NUM_REQUESTS];
+    long long expanded;   // nodes generated, for reporting
+} BeamPool;
+
+int cmp_beam_node(const void *a, const void *b) {
+    int x = ((const BeamNode *)a)->score;
+    int y = ((const BeamNode *)b)->score;
+    return (x > y) - (x < y);
+}
+
+/* Movement still needed from head to serve the requests not in
+ * visited: the optimal_movement closed form over that set, so
+ * short look-aheads neither strand far-off requests nor run to an
+ * extreme and leave nearby ones behind. */
+int pending_movement(int req[], unsigned long long visited, int head) {
+    int lo = NUM_CYLINDERS, hi = -1;
+    for (int i = 0; i < NUM_REQUESTS; i++) {
+        if (visited >> i & 1) continue;
+        if (req[i] < lo) lo = req[i];
+        if (req[i] > hi) hi = req[i];
+    }
+    if (hi < 0) return 0;
+    int toLo = abs(head - lo), toHi = abs(head - hi);
+    return hi - lo + (toLo < toHi ? toLo : toHi);
+}
+
+Result schedule_beam(int req[], int start, int k, int b,
+                     BeamPool *pool) {
+    Result r;
+    int dist[NUM_REQUESTS];
+    unsigned long long visited = 0;
+    int head = start;
+
+    r.len = 0;
+    pool->expanded = 0;
+
+    while (r.len < NUM_REQUESTS) {
+        BeamNode *cur = pool->level[0];
+        BeamNode *next = pool->level[1];
+        int curLen = 1;
+        int depth = NUM_REQUESTS - r.len < k ? NUM_REQUESTS - r.len : k;
+
+        cur[0].visited = visited;
+        cur[0].head = head;
+        cur[0].cost = 0;
+        cur[0].score = 0;
+        cur[0].first = -1;
+
+        for (int d = 0; d < depth; d++) {
+            int nextLen = 0;
+
+            for (int c = 0; c < curLen; c++) {
+                const BeamNode *node = &cur[c];
+
+                for (int i = 0; i < NUM_REQUESTS; i++)
+                    dist[i] = abs(req[i] - node->head);
+
+                for (int i = 0; i < NUM_REQUESTS; i++) {
+                    if (node->visited >> i & 1) continue;
+                    BeamNode *child = &next[nextLen++];
+                    child->visited = node->visited | 1ULL << i;
+                    child->head = req[i];
+                    child->cost = node->cost + dist[i];
+                    child->first = node->first < 0 ? i : node->first;
+                }
+            }
+
+            pool->expanded += nextLen;
+            for (int c = 0; c < nextLen; c++)
+                next[c].score = next[c].cost
+                              + pending_movement(req, next[c].visited,
+                                                 next[c].head);
+            qsort(next, nextLen, sizeof(BeamNode), cmp_beam_node);
+            curLen = nextLen < b ? nextLen : b;
+
+            BeamNode *tmp = cur;
+            cur = next;
+            next = tmp;
+        }
+
+        // cur[0] is the best path; commit its first move
+        int pick = cur[0].first;
+        visited |= 1ULL << pick;
+        head = req[pick];
+        r.seq[r.len++] = req[pick];
+    }
+
+    r.movement = compute_movement(r.seq, r.len, start);
+    return r;
+}
+
+/****************************************************************
+ * Offline schedule optimizer
+ * Searches service orders (arrival indices) for the minimum of
+ *   movement + weight * total lateness
+ * where request i is due by service slot i + slack and lateness
+ * is how many slots past that it is served. Simulated annealing
+ * over two neighbourhoods:
+ *   - 2-opt: reverse order[a..b]
+ *   - Or-opt: move a segment of 1-3 requests to a later or an
+ *     earlier slot, done as a rotation of the span it crosses
+ * Movement deltas are O(1) (only the cut edges change); lateness
+ * deltas only revisit the slots that moved.
+ ****************************************************************/
+#define ANNEAL_ITERS 50000
+#define ANNEAL_T0    50.0
+#define ANNEAL_TEND  0.05
+
+typedef struct {
+    double weight;
+    int slack;
+} Objective;
+
+typedef struct {
+    int order[NUM_REQUESTS];
+    int movement;
+    int lateness;
+    double cost;
+} Schedule;
+
+/* splitmix64: small, seedable, independent per restart. */
+unsigned long long rng_next(unsigned long long *state) {
+    unsigned long long z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+double rng_unit(unsigned long long *state) {
+    return (rng_next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+int slot_lateness(int slot, int idx, int slack) {
+    int late = slot - idx - slack;
+    return late > 0 ? late : 0;
+}
+
+void evaluate_schedule(int req[], int start, Objective obj, Schedule *s) {
+    int head = start;
+    s->movement = 0;
+    s->lateness = 0;
+    for (int k = 0; k < NUM_REQUESTS; k++) {
+        s->movement += abs(req[s->order[k]] - head);
+        head = req[s->order[k]];
+        s->lateness += slot_lateness(k, s->order[k], obj.slack);
+    }
+    s->cost = s->movement + obj.weight * s->lateness;
+}
+
+/* Cylinder at slot k, with slot -1 standing for the start. */
+int slot_cyl(int req[], const int order[], int k, int start) {
+    return k < 0 ? start : req[order[k]];
+}
+
+/* |a - b|, or 0 when b is past the end of the schedule. */
+int edge(int a, int bSlot, int b) {
+    return bSlot < NUM_REQUESTS ? abs(a - b) : 0;
+}
+
+/****************************************************************
+ * anneal_schedule
+ * One annealing run from the seed order already in s.
+ ****************************************************************/
+void anneal_schedule(int req[], int start, Objective obj,
+                     unsigned long long seed, Schedule *s) {
+    unsigned long long rng = seed;
+    Schedule best = *s;
+    int *o = s->order;
+    int tmp[NUM_REQUESTS];
+    double cool = pow(ANNEAL_TEND / ANNEAL_T0, 1.0 / ANNEAL_ITERS);
+    double T = ANNEAL_T0;
+
+    for (int it = 0; it < ANNEAL_ITERS; it++, T *= cool) {
+        int a = (int)(rng_next(&rng) % NUM_REQUESTS);
+        int b = (int)(rng_next(&rng) % NUM_REQUESTS);
+        if (a == b) continue;
+        if (a > b) { int t = a; a = b; b = t; }
+
+        int twoOpt = rng_next(&rng) & 1;
+        int L = 1 + (int)(rng_next(&rng) % 3), R = 0;
+        int dMove, dLate = 0;
+
+        int prev = slot_cyl(req, o, a - 1, start);
+        int after = slot_cyl(req, o, b + 1 < NUM_REQUESTS ? b + 1 : b,
+                             start);
+
+        if (twoOpt) {
+            // reverse [a, b]: edges into a and out of b change
+            dMove = abs(prev - req[o[b]]) + edge(req[o[a]], b + 1, after)
+                  - abs(prev - req[o[a]]) - edge(req[o[b]], b + 1, after);
+            for (int k = a; k <= b; k++)
+                dLate += slot_lateness(k, o[a + b - k], obj.slack)
+                       - slot_lateness(k, o[k], obj.slack);
+        } else {
+            // rotate [a, b] left by R: [a, a+R) moves behind the rest.
+            // R = L moves the first L requests later, R = span - L
+            // moves the last L earlier.
+            if (L > b - a) L = b - a;
+            int span = b - a + 1;
+            R = rng_next(&rng) & 1 ? L : span - L;
+            int m = a + R;
+            dMove = abs(prev - req[o[m]])
+                  + abs(req[o[b]] - req[o[a]])
+                  + edge(req[o[m - 1]], b + 1, after)
+                  - abs(prev - req[o[a]])
+                  - abs(req[o[m - 1]] - req[o[m]])
+                  - edge(req[o[b]], b + 1, after);
+            for (int k = a; k <= b; k++)
+                dLate += slot_lateness(k, o[a + (k - a + R) % span],
+                                       obj.slack)
+                       - slot_lateness(k, o[k], obj.slack);
+        }
+
+        double delta = dMove + obj.weight * dLate;
+        if (delta > 0 && rng_unit(&rng) >= exp(-delta / T))
+            continue;
+
+        if (twoOpt) {
+            for (int i = a, j = b; i < j; i++, j--) {
+                int t = o[i]; o[i] = o[j]; o[j] = t;
+            }
+        } else {
+            int span = b - a + 1;
+            for (int k = 0; k < span; k++)
+                tmp[k] = o[a + (k + R) % span];
+            memcpy(&o[a], tmp, span * sizeof(int));
+        }
+        s->movement += dMove;
+        s->lateness += dLate;
+        s->cost += delta;
+
+        if (s->cost < best.cost) best = *s;
+    }
+    *s = best;
+}
+
+/****************************************************************
+ * run_algorithm
+ * Dispatches one algorithm by enum. FCFS and SSTF use arrival
+ * order; the sweeps use the sorted array.
+ ****************************************************************/
+Result run_algorithm(Algorithm alg, int req[], int sorted[], int start,
+                     Direction dir) {
+    switch (alg) {
+    case ALG_FCFS:  return schedule_fcfs(req, start);
+    case ALG_SSTF:  return schedule_sstf(req, start);
+    case ALG_SCAN:  return schedule_scan(sorted, start, dir);
+    case ALG_CSCAN: return schedule_cscan(sorted, start, dir);
+    case ALG_LOOK:  return schedule_look(sorted, start, dir);
+    default:        return schedule_clook(sorted, start, dir);
+    }
+}
+
+/****************************************************************
+ * Result cache
+ * Persistent memo of scheduler results, stored as
+ *   <cache dir>/results.log
+ * an append-only log of fixed-size CacheRecords, each keyed by
+ * (trace hash, algorithm, start, direction) and guarded by a
+ * checksum. On open the log is scanned into an in-memory
+ * open-addressing index; lookups never touch the file again.
+ *
+ * Concurrency: records are only ever appended, each with a single
+ * write to a file opened in append mode, so other processes
+ * reading the log see whole records or a short tail. A torn or
+ * corrupt record fails the magic/checksum test, and the scan
+ * resyncs byte by byte to the next valid record, so records
+ * appended after it stay reachable. Duplicate keys are harmless:
+ * results are deterministic.
+ ****************************************************************/
+#define CACHE_MAGIC 0x44535231u   // "DSR1"
+
+typedef struct {
+    unsigned long long trace;
+    int alg;
+    int start;
+    int dir;      // -1 for direction-independent algorithms
+} ScenarioKey;
+
+typedef struct {
+    unsigned int magic;
+    ScenarioKey key;
+    Result result;
+    unsigned long long check;
+} CacheRecord;
+
+typedef struct {
+    FILE *log;          // append handle, NULL if unwritable
+    CacheRecord *recs;
+    int len, cap;
+    int *slots;         // record index + 1, 0 for empty
+    int nslots;         // power of two, kept at most half full
+} ResultCache;
+
+ScenarioKey scenario_key(unsigned long long trace, Algorithm alg,
+                         int start, Direction dir) {
+    ScenarioKey k;
+    memset(&k, 0, sizeof(k));
+    k.trace = trace;
+    k.alg = alg;
+    k.start = start;
+    k.dir = (alg == ALG_FCFS || alg == ALG_SSTF) ? -1 : (int)dir;
+    return k;
+}
+
+unsigned long long record_checksum(const CacheRecord *r) {
+    return fnv1a(FNV_OFFSET, r, offsetof(CacheRecord, check));
+}
+
+int cache_slot(const ResultCache *rc, const ScenarioKey *k) {
+    unsigned long long h = fnv1a(FNV_OFFSET, k, sizeof(*k));
+    int mask = rc->nslots - 1;
+    int s = (int)(h & (unsigned long long)mask);
+
+    while (rc->slots[s] &&
+           memcmp(&rc->recs[rc->slots[s] - 1].key, k, sizeof(*k)) != 0)
+        s = (s + 1) & mask;
+    return s;
+}
+
+/* Out of memory just leaves r unindexed: the cache is a memo. */
+void cache_index(ResultCache *rc, const CacheRecord *r) {
+    if (2 * (rc->len + 1) > rc->nslots) {
+        int nslots = rc->nslots ? 2 * rc->nslots : 64;
+        int *slots = calloc(nslots, sizeof(int));
+        if (!slots) return;
+        free(rc->slots);
+        rc->slots = slots;
+        rc->nslots = nslots;
+        for (int i = 0; i < rc->len; i++)
+            rc->slots[cache_slot(rc, &rc->recs[i].key)] = i + 1;
+    }
+
+    int s = cache_slot(rc, &r->key);
+    if (rc->slots[s]) return;   // duplicate key
+
+    if (rc->len == rc->cap) {
+        int cap = rc->cap ? 2 * rc->cap : 64;
+        CacheRecord *recs = realloc(rc->recs, cap * sizeof(CacheRecord));
+        if (!recs) return;
+        rc->recs = recs;
+        rc->cap = cap;
+    }
+    rc->recs[rc->len++] = *r;
+    rc->slots[s] = rc->len;
+}
+
+/****************************************************************
+ * cache_open
+ * Loads the result log from dir and opens it for appending.
+ ****************************************************************/
+void cache_open(ResultCache *rc, const char *dir) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/results.log", dir);
+    memset(rc, 0, sizeof(*rc));
+
+    FILE *fp = fopen(path, "rb");
+    if (fp) {
+        unsigned char *data = NULL;
+        size_t len = 0, cap = 0, got = 0;
+        do {
+            len += got;
+            if (len == cap) {
+                unsigned char *grown = realloc(data, cap ? 2 * cap : 65536);
+                if (!grown) break;
+                data = grown;
+                cap = cap ? 2 * cap : 65536;
+            }
+        } while ((got = fread(data + len, 1, cap - len, fp)) > 0);
+        fclose(fp);
+
+        size_t off = 0;
+        while (off + sizeof(CacheRecord) <= len) {
+            CacheRecord r;
+            memcpy(&r, data + off, sizeof(r));
+            if (r.magic == CACHE_MAGIC && r.check == record_checksum(&r)) {
+                cache_index(rc, &r);
+                off += sizeof(r);
+            } else {
+                off++;   // torn record: resync on the next magic
+            }
+        }
+        free(data);
+    }
+
+    rc->log = fopen(path, "ab");
+}
+
+void cache_close(ResultCache *rc) {
+    if (rc->log) fclose(rc->log);
+    free(rc->recs);
+    free(rc->slots);
+}
+
+/****************************************************************
+ * cached_run
+ * Serves a scenario from the cache, or runs the scheduler and
+ * appends the result. A NULL cache simply runs the scheduler.
+ ****************************************************************/
+Result cached_run(ResultCache *rc, unsigned long long trace,
+                  Algorithm alg, int req[], int sorted[], int start,
+                  Direction dir) {
+    if (!rc) return run_algorithm(alg, req, sorted, start, dir);
+
+    ScenarioKey k = scenario_key(trace, alg, start, dir);
+    if (rc->nslots) {
+        int s = cache_slot(rc, &k);
+        if (rc->slots[s]) return rc->recs[rc->slots[s] - 1].result;
+    }
+
+    CacheRecord r;
+    memset(&r, 0, sizeof(r));
+    r.magic = CACHE_MAGIC;
+    r.key = k;
+    r.result = run_algorithm(alg, req, sorted, start, dir);
+    // the schedulers leave seq[len..] unset; keep records deterministic
+    memset(r.result.seq + r.result.len, 0,
+           sizeof(r.result.seq) - r.result.len * sizeof(int));
+    r.check = record_checksum(&r);
+
+    if (rc->log && fwrite(&r, sizeof(r), 1, rc->log) == 1)
+        fflush(rc->log);
+    cache_index(rc, &r);
+    return r.result;
+}
+
+/****************************************************************
+ * AddrMap
+ * Compact open-addressing map from 64-bit block address to a
+ * count, used to gather access frequencies. Memory follows the
+ * number of distinct blocks touched (12 bytes per slot, at most
+ * three quarters full), not the size of the address space, so
+ * traces over 1e9-block devices are fine. Keys are stored + 1,
+ * leaving 0 as the empty marker.
+ ****************************************************************/
+typedef struct {
+    unsigned long long *keys;
+    unsigned int *vals;
+    long long len, nslots;   // nslots is a power of two
+} AddrMap;
+
+long long addrmap_slot(const AddrMap *m, unsigned long long key) {
+    unsigned long long h = key;
+    long long mask = m->nslots - 1;
+    long long s = (long long)(rng_next(&h) & (unsigned long long)mask);
+
+    while (m->keys[s] && m->keys[s] != key + 1)
+        s = (s + 1) & mask;
+    return s;
+}
+
+/* Returns 0, leaving m as it was, if the new table cannot be
+ * allocated. */
+int addrmap_grow(AddrMap *m) {
+    AddrMap old = *m;
+    m->nslots = old.nslots ? 2 * old.nslots : 1024;
+    m->keys = calloc(m->nslots, sizeof(*m->keys));
+    m->vals = calloc(m->nslots, sizeof(*m->vals));
+    if (!m->keys || !m->vals) {
+        free(m->keys);
+        free(m->vals);
+        *m = old;
+        return 0;
+    }
+
+    for (long long i = 0; i < old.nslots; i++) {
+        if (!old.keys[i]) continue;
+        long long s = addrmap_slot(m, old.keys[i] - 1);
+        m->keys[s] = old.keys[i];
+        m->vals[s] = old.vals[i];
+    }
+    free(old.keys);
+    free(old.vals);
+    return 1;
+}
+
+/* The block's value, inserted at zero if missing. Returns NULL if
+ * the map is full and cannot grow. */
+unsigned int *addrmap_ref(AddrMap *m, unsigned long long key) {
+    if (4 * (m->len + 1) > 3 * m->nslots && !addrmap_grow(m)) return NULL;
+
+    long long s = addrmap_slot(m, key);
+    if (!m->keys[s]) {
+        m->keys[s] = key + 1;
+        m->len++;
+    }
+    return &m->vals[s];
+}
+
+/* Returns 0 if the key could not be inserted. */
+int addrmap_add(AddrMap *m, unsigned long long key, unsigned int delta) {
+    unsigned int *v = addrmap_ref(m, key);
+    if (!v) return 0;
+    *v += delta;
+    return 1;
+}
+
+/* Returns the block's value, or -1 if it is not in the map. */
+long long addrmap_get(const AddrMap *m, unsigned long long key) {
+    if (!m->nslots) return -1;
+    long long s = addrmap_slot(m, key);
+    return m->keys[s] ? (long long)m->vals[s] : -1;
+}
+
+void addrmap_free(AddrMap *m) {
+    free(m->keys);
+    free(m->vals);
+    memset(m, 0, sizeof(*m));
+}
+
+/****************************************************************
+ * Data placement
+ * Offline layout optimizer: ranks blocks by access count and
+ * packs them, hottest first, perCyl blocks to a cylinder, either
+ *   - PLACE_ORGAN: organ-pipe around the middle cylinder
+ *                  (middle, middle + 1, middle - 1, ...), or
+ *   - PLACE_FREQ:  frequency order from the outer edge
+ *                  (cylinder 0, the fastest ZBR zone).
+ * The result is written back into the map: each block's value
+ * becomes its new cylinder.
+ ****************************************************************/
+typedef enum { PLACE_ORGAN, PLACE_FREQ } PlacementKind;
+
+typedef struct {
+    unsigned long long key;
+    unsigned int count;
+} BlockHeat;
+
+int cmp_block_heat(const void *a, const void *b) {
+    const BlockHeat *x = a, *y = b;
+    if (x->count != y->count) return x->count < y->count ? 1 : -1;
+    return (x->key > y->key) - (x->key < y->key);
+}
+
+/* Cylinder of the k-th placement slot (slots are cylinder-sized). */
+int placement_cyl(PlacementKind kind, long long k) {
+    if (kind == PLACE_FREQ) return (int)k;
+    int mid = (NUM_CYLINDERS - 1) / 2;
+    return (int)(k % 2 ? mid + (k + 1) / 2 : mid - k / 2);
+}
+
+/* Returns 0 if the blocks do not fit on the disk, -1 if out of
+ * memory. */
+int place_blocks(AddrMap *m, PlacementKind kind, long long perCyl) {
+    if (m->len > perCyl * NUM_CYLINDERS) return 0;
+
+    BlockHeat *heat = malloc((m->len ? m->len : 1) * sizeof(BlockHeat));
+    if (!heat) return -1;
+    long long n = 0;
+    for (long long i = 0; i < m->nslots; i++)
+        if (m->keys[i]) {
+            heat[n].key = m->keys[i] - 1;
+            heat[n++].count = m->vals[i];
+        }
+    qsort(heat, n, sizeof(BlockHeat), cmp_block_heat);
+
+    for (long long k = 0; k < n; k++)
+        m->vals[addrmap_slot(m, heat[k].key)] =
+            (unsigned int)placement_cyl(kind, k / perCyl);
+    free(heat);
+    return 1;
+}
+
+/****************************************************************
+ * Defect remap table
+ * Grown defects are reallocated to spare tracks on the top
+ * SPARE_CYLS cylinders: the k-th defect to appear goes to spare
+ * cylinder FIRST_SPARE + k % SPARE_CYLS. The table is a vector
+ * sorted by defective cylinder, resolved by binary search.
+ * Cylinder 0 and the spares never go bad, so SCAN endpoints and
+ * remap targets always resolve to themselves.
+ ****************************************************************/
+#define SPARE_CYLS     10
+#define FIRST_SPARE    (NUM_CYLINDERS - SPARE_CYLS)
+#define DATA_DEFECTS   (FIRST_SPARE - 1)   // cylinders 1..FIRST_SPARE-1
+#define DEFECT_SCRATCH 8                   // longest clustered run
+
+typedef struct {
+    int from, to;
+} Remap;
+
+typedef struct {
+    Remap map[DATA_DEFECTS];
+    int n;
+} RemapTable;
+
+int cmp_remap(const void *a, const void *b) {
+    const Remap *x = a, *y = b;
+    return (x->from > y->from) - (x->from < y->from);
+}
+
+/* Builds the table for the first k defects of grown[]. */
+void remap_build(RemapTable *t, const int grown[], int k) {
+    t->n = k;
+    for (int i = 0; i < k; i++) {
+        t->map[i].from = grown[i];
+        t->map[i].to = FIRST_SPARE + i % SPARE_CYLS;
+    }
+    qsort(t->map, k, sizeof(Remap), cmp_remap);
+}
+
+int remap_resolve(const RemapTable *t, int cyl) {
+    int lo = 0, hi = t->n;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (t->map[mid].from < cyl) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < t->n && t->map[lo].from == cyl ? t->map[lo].to : cyl;
+}
+
+/* compute_movement for a sequence of logical cylinders. */
+int remapped_movement(const int seq[], int len, int start,
+                      const RemapTable *t) {
+    int head = start;
+    int total = 0;
+
+    for (int i = 0; i < len; i++) {
+        int cyl = remap_resolve(t, seq[i]);
+        total += abs(cyl - head);
+        head = cyl;
+    }
+    return total;
+}
+
+/****************************************************************
+ * Defect generators
+ * Fill grown[] with every data cylinder in the order its defect
+ * appears, so an aging drive's table is just a longer prefix:
+ *   - DEFECT_UNIFORM: independent defects, uniformly placed
+ *   - DEFECT_CLUSTER: scratches of 1..DEFECT_SCRATCH adjacent
+ *                     cylinders at random positions
+ ****************************************************************/
+typedef enum { DEFECT_UNIFORM, DEFECT_CLUSTER } DefectKind;
+
+void defect_order(DefectKind kind, unsigned long long *rng, int grown[]) {
+    if (kind == DEFECT_UNIFORM) {
+        for (int i = 0; i < DATA_DEFECTS; i++) grown[i] = i + 1;
+        for (int i = DATA_DEFECTS - 1; i > 0; i--) {
+            int j = (int)(rng_next(rng) % (unsigned long long)(i + 1));
+            int tmp = grown[i];
+            grown[i] = grown[j];
+            grown[j] = tmp;
+        }
+        return;
+    }
+
+    char seen[FIRST_SPARE] = {0};
+    int n = 0;
+    while (n < DATA_DEFECTS) {
+        int at = 1 + (int)(rng_next(rng) % DATA_DEFECTS);
+        int len = 1 + (int)(rng_next(rng) % DEFECT_SCRATCH);
+        for (int c = at; c < at + len && c < FIRST_SPARE; c++)
+            if (!seen[c]) {
+                seen[c] = 1;
+                grown[n++] = c;
+            }
+    }
+}
+
+/****************************************************************
+ * Serpentine tape geometry
+ * Linear tape (LTO-style) stores data in wraps that run the full
+ * length of the tape, alternating direction: even wraps are read
+ * from BOT to EOT, odd wraps back again. Wraps are grouped into
+ * TAPE_BANDS bands. A logical block maps to its wrap and a
+ * longitudinal position (lpos, metres from BOT).
+ * Locate cost, in seconds:
+ *   - |delta lpos| at TAPE_LOCATE_MPS
+ *   - TAPE_REVERSE_S whenever the tape changes direction,
+ *     including to read the target in its wrap's direction
+ *   - TAPE_WRAP_SWITCH_S to step to another wrap, plus
+ *     TAPE_BAND_SWITCH_S if it is in another band
+ ****************************************************************/
+#define TAPE_LENGTH_M       820.0
+#define TAPE_LOCATE_MPS     8.0
+#define TAPE_REVERSE_S      1.0
+#define TAPE_WRAP_SWITCH_S  1.5
+#define TAPE_BAND_SWITCH_S  4.0
+#define TAPE_BANDS          4
+#define TAPE_WRAPS          52
+#define TAPE_BLOCKS_PER_WRAP 100000LL
+
+typedef struct {
+    int wrap;
+    double lpos;
+    int motion;     // +1 towards EOT, -1 towards BOT
+} TapePos;
+
+int wrap_dir(int wrap) {
+    return wrap % 2 ? -1 : 1;
+}
+
+TapePos tape_position(long long block) {
+    TapePos p;
+    p.wrap = (int)(block / TAPE_BLOCKS_PER_WRAP);
+    double frac = (block % TAPE_BLOCKS_PER_WRAP + 0.5) / TAPE_BLOCKS_PER_WRAP;
+    p.lpos = (wrap_dir(p.wrap) > 0 ? frac : 1 - frac) * TAPE_LENGTH_M;
+    p.motion = wrap_dir(p.wrap);
+    return p;
+}
+
+/* Locates from *head to the start of block and leaves head there. */
+double tape_locate(TapePos *head, long long block) {
+    TapePos to = tape_position(block);
+    double cost = fabs(to.lpos - head->lpos) / TAPE_LOCATE_MPS;
+    int motion = head->motion;
+
+    if (to.lpos != head->lpos) {
+        int move = to.lpos > head->lpos ? 1 : -1;
+        if (move != motion) cost += TAPE_REVERSE_S;
+        motion = move;
+    }
+    if (motion != to.motion) cost += TAPE_REVERSE_S;
+
+    if (to.wrap != head->wrap) {
+        cost += TAPE_WRAP_SWITCH_S;
+        int per = TAPE_WRAPS / TAPE_BANDS;
+        if (to.wrap / per != head->wrap / per) cost += TAPE_BAND_SWITCH_S;
+    }
+
+    *head = to;
+    return cost;
+}
+
+/****************************************************************
+ * Tape schedulers
+ * Each fills order[] with a service order of blocks[0..n):
+ *   - TAPE_FIFO:  arrival order
+ *   - TAPE_SORT:  logical block order (wrap by wrap)
+ *   - TAPE_SLTF:  greedy shortest locate time first
+ *   - TAPE_SWEEP: LOOK adapted to wraps. Two plans are costed
+ *                 and the cheaper one is kept:
+ *                   - per request: the tape keeps moving in one
+ *                     direction, serving the cheapest request
+ *                     ahead on any wrap read that way, and turns
+ *                     only when none is left
+ *                   - per wrap: it enters the wrap whose first
+ *                     pending request is cheapest to reach and
+ *                     finishes that wrap before switching
+ *                 Sparse batches favour the first, since a wrap
+ *                 switch costs less than the travel it saves.
+ *                 Dense ones favour the second, where every
+ *                 switch is paid again on the way back.
+ * For a given wrap and side of the head, locate time grows with
+ * distance, so the greedy steps only look at the nearest pending
+ * request on each side of the head on each wrap (TapeIndex),
+ * which costs O(wraps log n) per step instead of O(n).
+ ****************************************************************/
+typedef enum { TAPE_FIFO, TAPE_SORT, TAPE_SLTF, TAPE_SWEEP,
+               NUM_TAPE_ALGS } TapeAlgorithm;
+
+const char *TAPE_NAMES[NUM_TAPE_ALGS] = {
+    "FIFO", "LBA-SORT", "SLTF", "WRAP-LOOK"
+};
+
+typedef struct {
+    double key;
+    long long block;
+    int idx;
+} TapeKey;
+
+int cmp_tape_key(const void *a, const void *b) {
+    const TapeKey *x = a, *y = b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return (x->block > y->block) - (x->block < y->block);
+}
+
+/* Orders by key, breaking ties by block. */
+void tape_sort_by(const long long blocks[], const double keys[], int n,
+                  int order[]) {
+    TapeKey *k = malloc(n * sizeof(TapeKey));
+    for (int i = 0; i < n; i++) {
+        k[i].key = keys[i];
+        k[i].block = blocks[i];
+        k[i].idx = i;
+    }
+    qsort(k, n, sizeof(TapeKey), cmp_tape_key);
+    for (int i = 0; i < n; i++) order[i] = k[i].idx;
+    free(k);
+}
+
+/*
+ * Pending requests sorted by (wrap, lpos). Served positions are
+ * skipped through union-find links with path halving: next[k] is
+ * the first pending position >= k, and prev[k + 1] is the last
+ * pending position <= k, plus one (0 means none).
+ */
+typedef struct {
+    int *req;                   // request index at each position
+    double *lpos;
+    int first[TAPE_WRAPS + 1];  // wrap w holds [first[w], first[w + 1])
+    int *next, *prev;
+} TapeIndex;
+
+void tape_index_build(TapeIndex *ix, const long long blocks[], int n) {
+    double *keys = calloc(n, sizeof(double));
+    for (int i = 0; i < n; i++) {
+        TapePos p = tape_position(blocks[i]);
+        keys[i] = p.wrap * 2 * TAPE_LENGTH_M + p.lpos;
+    }
+    ix->req = malloc(n * sizeof(int));
+    tape_sort_by(blocks, keys, n, ix->req);
+    free(keys);
+
+    ix->lpos = malloc(n * sizeof(double));
+    ix->next = malloc((n + 1) * sizeof(int));
+    ix->prev = malloc((n + 1) * sizeof(int));
+    int w = 0;
+    ix->first[0] = 0;
+    for (int k = 0; k < n; k++) {
+        TapePos p = tape_position(blocks[ix->req[k]]);
+        while (w < p.wrap) ix->first[++w] = k;
+        ix->lpos[k] = p.lpos;
+    }
+    while (w < TAPE_WRAPS) ix->first[++w] = n;
+    for (int k = 0; k <= n; k++) ix->next[k] = ix->prev[k] = k;
+}
+
+void tape_index_free(TapeIndex *ix) {
+    free(ix->req);
+    free(ix->lpos);
+    free(ix->next);
+    free(ix->prev);
+}
+
+int skip_find(int link[], int k) {
+    while (link[k] != k) {
+        link[k] = link[link[k]];
+        k = link[k];
+    }
+    return k;
+}
+
+void tape_index_take(TapeIndex *ix, int k) {
+    ix->next[k] = k + 1;
+    ix->prev[k + 1] = k;
+}
+
+/* First position on wrap w with lpos >= x (pending), or -1. */
+int tape_at_or_after(TapeIndex *ix, int w, double x) {
+    int lo = ix->first[w], hi = ix->first[w + 1];
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (ix->lpos[mid] < x) lo = mid + 1;
+        else hi = mid;
+    }
+    int k = skip_find(ix->next, lo);
+    return k < ix->first[w + 1] ? k : -1;
+}
+
+/* Last position on wrap w with lpos <= x (pending), or -1. */
+int tape_at_or_before(TapeIndex *ix, int w, double x) {
+    int lo = ix->first[w], hi = ix->first[w + 1];
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (ix->lpos[mid] <= x) lo = mid + 1;
+        else hi = mid;
+    }
+    int k = skip_find(ix->prev, lo) - 1;
+    return k >= ix->first[w] ? k : -1;
+}
+
+/*
+ * Cheapest pending position from head: on every wrap when sweep
+ * is 0, else only ahead of the head on wraps read in direction
+ * sweep. Ties go to the earliest request. Returns -1 if none.
+ */
+int tape_pick(TapeIndex *ix, const long long blocks[], TapePos head,
+              int sweep) {
+    int best = -1;
+    double bestCost = INFINITY;
+    for (int w = 0; w < TAPE_WRAPS; w++) {
+        if (sweep && wrap_dir(w) != sweep) continue;
+        int cand[2] = {
+            sweep >= 0 ? tape_at_or_after(ix, w, head.lpos) : -1,
+            sweep <= 0 ? tape_at_or_before(ix, w, head.lpos) : -1
+        };
+        for (int s = 0; s < 2; s++) {
+            int k = cand[s];
+            if (k < 0) continue;
+            TapePos h = head;
+            double c = tape_locate(&h, blocks[ix->req[k]]);
+            if (c < bestCost
+                || (c == bestCost && ix->req[k] < ix->req[best])) {
+                bestCost = c;
+                best = k;
+            }
+        }
+    }
+    return best;
+}
+
+/* Greedy SLTF, restricted for the sweep to requests ahead. */
+void tape_greedy(TapeAlgorithm alg, const long long blocks[], int n,
+                 TapePos head, int order[]) {
+    TapeIndex ix;
+    tape_index_build(&ix, blocks, n);
+    int sweep = head.motion;
+
+    for (int k = 0; k < n; k++) {
+        int pos = -1;
+        if (alg == TAPE_SWEEP) {
+            pos = tape_pick(&ix, blocks, head, sweep);
+            if (pos < 0) {   // nothing ahead: turn
+                sweep = -sweep;
+                pos = tape_pick(&ix, blocks, head, sweep);
+            }
+        }
+        if (pos < 0) pos = tape_pick(&ix, blocks, head, 0);
+        tape_index_take(&ix, pos);
+        order[k] = ix.req[pos];
+        tape_locate(&head, blocks[order[k]]);
+    }
+    tape_index_free(&ix);
+}
+
+/*
+ * Serves whole wraps, entering the cheapest one to reach next.
+ * It stays in a band until the band's wraps are done, and takes
+ * a band's wraps from whichever direction has more left, so that
+ * reads alternate direction without a spare pass back.
+ */
+void tape_by_wrap(const long long blocks[], int n, TapePos head,
+                  int order[]) {
+    const int per = TAPE_WRAPS / TAPE_BANDS;
+    TapeIndex ix;
+    tape_index_build(&ix, blocks, n);
+    int done[TAPE_WRAPS] = { 0 };
+    int left[TAPE_BANDS][2] = { { 0 } };   // pending wraps [band][dir]
+    for (int w = 0; w < TAPE_WRAPS; w++)
+        if (ix.first[w] < ix.first[w + 1]) left[w / per][wrap_dir(w) > 0]++;
+    int k = 0;
+
+    while (k < n) {
+        int band = head.wrap / per;
+        int stay = left[band][0] + left[band][1] > 0;
+        int best = -1;
+        double bestCost = INFINITY;
+        for (int w = 0; w < TAPE_WRAPS; w++) {
+            int b = w / per, d = wrap_dir(w) > 0;
+            if (done[w] || ix.first[w] == ix.first[w + 1]) continue;
+            if ((stay && b != band) || left[b][d] < left[b][!d]) continue;
+            int entry = wrap_dir(w) > 0 ? ix.first[w] : ix.first[w + 1] - 1;
+            TapePos h = head;
+            double c = tape_locate(&h, blocks[ix.req[entry]]);
+            if (c < bestCost) {
+                bestCost = c;
+                best = w;
+            }
+        }
+        done[best] = 1;
+        left[best / per][wrap_dir(best) > 0]--;
+        int lo = ix.first[best], hi = ix.first[best + 1];
+        for (int j = 0; j < hi - lo; j++) {
+            int pos = wrap_dir(best) > 0 ? lo + j : hi - 1 - j;
+            order[k++] = ix.req[pos];
+        }
+        tape_locate(&head, blocks[order[k - 1]]);
+    }
+    tape_index_free(&ix);
+}
+
+double tape_order_cost(const long long blocks[], const int order[], int n,
+                       TapePos head) {
+    double total = 0;
+    for (int k = 0; k < n; k++) total += tape_locate(&head, blocks[order[k]]);
+    return total;
+}
+
+void tape_schedule(TapeAlgorithm alg, const long long blocks[], int n,
+                   TapePos head, int order[]) {
+    switch (alg) {
+    case TAPE_FIFO:
+        for (int i = 0; i < n; i++) order[i] = i;
+        break;
+    case TAPE_SORT: {
+        double *keys = malloc(n * sizeof(double));
+        for (int i = 0; i < n; i++) keys[i] = (double)blocks[i];
+        tape_sort_by(blocks, keys, n, order);
+        free(keys);
+        break;
+    }
+    case TAPE_SLTF:
+        tape_greedy(alg, blocks, n, head, order);
+        break;
+    default: {
+        int *byWrap = malloc(n * sizeof(int));
+        tape_greedy(alg, blocks, n, head, order);
+        tape_by_wrap(blocks, n, head, byWrap);
+        if (tape_order_cost(blocks, byWrap, n, head)
+            < tape_order_cost(blocks, order, n, head))
+            memcpy(order, byWrap, n * sizeof(int));
+        free(byWrap);
+        break;
+    }
+    }
+}
+
+/****************************************************************
+ * IoRequest
+ * Request record for the online paths: the cylinder plus the
+ * ordering constraints real I/O carries.
+ *   - REQ_BARRIER: every earlier request completes before it and
+ *                  no later request is serviced ahead of it
+ *   - REQ_FUA:     forced unit access with preflush; every earlier
+ *                  request completes first, later ones may pass
+ *   - dep:         arrival index that must complete first, or -1
+ * Generated workloads mark writes with REQ_WRITE, synchronous
+ * ones also with REQ_SYNC.
+ * The simulator also tags internal traffic with REQ_BACKGROUND
+ * (plus REQ_MIGRATE for data a workload moves itself, whose
+ * completions go back to that workload),
+ * stamps each request with its arrival time and lets the
+ * workload keep its own id (e.g. the issuing client) in tag;
+ * the scheduler layer stamps the deadline-scheduler expiry.
+ * Workloads that know the byte address (fio) also set lba, the
+ * first 512-byte sector, for the cache tier.
+ ****************************************************************/
+#define REQ_BARRIER    0x1
+#define REQ_FUA        0x2
+#define REQ_BACKGROUND 0x4
+#define REQ_WRITE      0x8
+#define REQ_SYNC       0x10
+#define REQ_MIGRATE    0x20
+
+typedef struct {
+    int cyl;
+    int flags;
+    int dep;
+    int tag;
+    int sectors;
+    int surface;
+    long long lba;
+    double arrival;
+    double deadline;
+} IoRequest;
+
+/****************************************************************
+ * DiskModel
+ * Service time of one request, in ms:
+ *   - flat model: seek + a fixed per-request service time
+ *   - zoned model (zbr set): seek + average rotational latency
+ *     + transfer, where transfer time depends on the request size
+ *     and on the zone: zoned bit recording puts more sectors on
+ *     the longer outer tracks (cylinder 0 is outermost), so the
+ *     same request transfers faster there
+ * Each cylinder has NUM_SURFACES tracks, one per head. Switching
+ * heads costs headSwitch ms of settle (0 disables the surface
+ * model), overlapped with any seek. Track skew is laid out for
+ * sequential access, so the switch to the next surface up is
+ * hidden by the skew and costs nothing.
+ ****************************************************************/
+#define SIM_SEEK_PER_CYL 0.05   // 15 ms full stroke
+#define SIM_SERVICE      2.0    // rotation + transfer per request
+#define SIM_SECTORS      8      // default request size (4 KiB)
+#define ZBR_REV_MS       8.333  // 7200 rpm
+#define NUM_SURFACES     4
+#define HEAD_SWITCH_MS   0.8
+
+typedef struct {
+    int firstCyl;
+    int sectorsPerTrack;
+} Zone;
+
+const Zone ZBR_ZONES[] = {
+    {   0, 1800 }, {  50, 1650 }, { 100, 1500 },
+    { 150, 1350 }, { 200, 1200 }, { 250, 1050 },
+};
+#define NUM_ZONES ((int)(sizeof(ZBR_ZONES) / sizeof(ZBR_ZONES[0])))
+
+typedef struct {
+    double seek_per_cyl;
+    double service;
+    int zbr;
+    double headSwitch;
+} DiskModel;
+
+int zone_of(int cyl) {
+    int z = NUM_ZONES - 1;
+    while (z > 0 && ZBR_ZONES[z].firstCyl > cyl) z--;
+    return z;
+}
+
+double transfer_time(const IoRequest *r) {
+    return (double)r->sectors
+         / ZBR_ZONES[zone_of(r->cyl)].sectorsPerTrack * ZBR_REV_MS;
+}
+
+/* 1 if moving from surface `from` to `to` pays a head switch. */
+int surface_switch(int from, int to) {
+    return to != from && to != from + 1;
+}
+
+double access_time(const DiskModel *m, int travel, int switched,
+                   const IoRequest *r) {
+    double seek = travel * m->seek_per_cyl;
+    if (switched && m->headSwitch > seek) seek = m->headSwitch;
+    if (!m->zbr) return seek + m->service;
+    return seek + ZBR_REV_MS / 2 + transfer_time(r);
+}
+
+/****************************************************************
+ * Online dispatch
+ * The batch schedulers above see the whole queue at once. The
+ * online paths instead ask pick_next for one request at a time
+ * from whatever is currently dispatchable, carrying the head
+ * position and sweep direction between calls in a HeadState.
+ *
+ * Sweep semantics per call:
+ *   - LOOK:   nearest request in the current direction, else
+ *             reverse
+ *   - SCAN:   as LOOK, but runs to the disk edge before reversing
+ *   - C-SCAN: runs to the edge, returns to the opposite edge and
+ *             keeps the direction
+ *   - C-LOOK: jumps to the farthest request behind the head and
+ *             keeps the direction
+ *   - DEADLINE: ascending C-LOOK sweep, except that an expired
+ *             oldest request is served first (mq-deadline with a
+ *             single FIFO)
+ * Requests on the head's cylinder count as being in either
+ * direction. Edge trips happen only while requests are pending,
+ * so a drained queue does not add a final trip to the boundary.
+ ****************************************************************/
+typedef struct {
+    Algorithm alg;
+    int head;
+    Direction dir;
+    double now;               // simulated time, for ALG_DEADLINE
+    const DiskModel *weigh;   // if set, SSTF minimizes access time
+    int surface;              // surface of the last request served
+} HeadState;
+
+/****************************************************************
+ * Candidates
+ * Read-only view of the dispatchable requests that pick_next
+ * works through, so the same sweep logic serves both small
+ * ready-set arrays and the simulator's bucketed queue:
+ *   - first:   handle of the earliest arrival
+ *   - nearest: handle of the nearest request on the dir side of
+ *              head (inclusive), earliest arrival on ties, or -1
+ *   - after:   next handle after h (-1 starts) when walking every
+ *              candidate that could be picked, or -1 at the end
+ *   - get:     the request behind a handle
+ *   - rank:    arrival rank of a handle (smaller is earlier)
+ *   - sibling: next later arrival on the same cylinder as h, or
+ *              -1
+ *   - expiring: handle with the earliest deadline, earliest
+ *              arrival on ties
+ ****************************************************************/
+typedef struct Candidates Candidates;
+struct Candidates {
+    int (*first)(const Candidates *c);
+    int (*nearest)(const Candidates *c, int head, Direction dir);
+    int (*after)(const Candidates *c, int h);
+    const IoRequest *(*get)(const Candidates *c, int h);
+    long long (*rank)(const Candidates *c, int h);
+    int (*sibling)(const Candidates *c, int h);
+    int (*expiring)(const Candidates *c);
+    const void *set;
+    int len;
+};
+
+/* Candidates over r[0..len) in arrival order; handles are array
+ * positions. */
+int array_first(const Candidates *c) {
+    (void)c;
+    return 0;
+}
+
+int array_nearest(const Candidates *c, int head, Direction dir) {
+    const IoRequest *r = (const IoRequest *)c->set;
+    int best = -1;
+    for (int i = 0; i < c->len; i++) {
+        int d = dir == DIR_RIGHT ? r[i].cyl - head : head - r[i].cyl;
+        if (d < 0) continue;
+        if (best < 0 || d < abs(r[best].cyl - head)) best = i;
+    }
+    return best;
+}
+
+int array_after(const Candidates *c, int h) {
+    return h + 1 < c->len ? h + 1 : -1;
+}
+
+const IoRequest *array_get(const Candidates *c, int h) {
+    return &((const IoRequest *)c->set)[h];
+}
+
+long long array_rank(const Candidates *c, int h) {
+    (void)c;
+    return h;
+}
+
+int array_sibling(const Candidates *c, int h) {
+    const IoRequest *r = (const IoRequest *)c->set;
+    for (int i = h + 1; i < c->len; i++)
+        if (r[i].cyl == r[h].cyl) return i;
+    return -1;
+}
+
+int array_expiring(const Candidates *c) {
+    const IoRequest *r = (const IoRequest *)c->set;
+    int best = 0;
+    for (int i = 1; i < c->len; i++)
+        if (r[i].deadline < r[best].deadline) best = i;
+    return best;
+}
+
+Candidates array_candidates(const IoRequest r[], int m) {
+    Candidates c = { array_first, array_nearest, array_after, array_get,
+                     array_rank, array_sibling, array_expiring, r, m };
+    return c;
+}
+
+/****************************************************************
+ * weighted_nearest
+ * Candidate with the smallest modelled access time (seek plus
+ * rotation and transfer) rather than the smallest seek distance.
+ * Earliest arrival wins ties.
+ ****************************************************************/
+int weighted_nearest(const HeadState *hs, const Candidates *c) {
+    int best = -1;
+    double bestCost = INFINITY;
+    for (int h = c->after(c, -1); h >= 0; h = c->after(c, h)) {
+        const IoRequest *r = c->get(c, h);
+        double cost = access_time(hs->weigh, abs(r->cyl - hs->head),
+                                  surface_switch(hs->surface, r->surface), r);
+        if (cost < bestCost
+            || (cost == bestCost && c->rank(c, h) < c->rank(c, best))) {
+            best = h;
+            bestCost = cost;
+        }
+    }
+    return best;
+}
+
+/****************************************************************
+ * surface_order
+ * Among the requests on h's cylinder, the one whose surface comes
+ * first rotating upward from the head's current surface, earliest
+ * arrival on ties. Serving a cylinder in that order pays one head
+ * switch per run of consecutive surfaces, which is the minimum
+ * when a switch up by one is hidden by track skew.
+ ****************************************************************/
+int surface_order(const HeadState *hs, const Candidates *c, int h) {
+    int best = h;
+    int bestD = NUM_SURFACES;
+    for (int s = h; s >= 0; s = c->sibling(c, s)) {
+        int d = ((c->get(c, s)->surface - hs->surface) % NUM_SURFACES
+                 + NUM_SURFACES) % NUM_SURFACES;
+        if (d < bestD) {
+            best = s;
+            bestD = d;
+        }
+    }
+    return best;
+}
+
+/****************************************************************
+ * pick_next
+ * Chooses one of the candidates, moves the head there and
+ * returns its handle. Any edge trips plus the final seek are
+ * added to *travel. When hs->weigh models head switches, the
+ * request within the chosen cylinder is picked by surface_order,
+ * unless arrival order made the choice (FCFS, expired DEADLINE).
+ ****************************************************************/
+int pick_next(HeadState *hs, const Candidates *c, int *travel) {
+    int p;
+    int fifo = 0;   // arrival order decided the pick
+    Direction back = hs->dir == DIR_LEFT ? DIR_RIGHT : DIR_LEFT;
+    int edge = hs->dir == DIR_LEFT ? 0 : NUM_CYLINDERS - 1;
+
+    switch (hs->alg) {
+    case ALG_FCFS:
+        p = c->first(c);
+        fifo = 1;
+        break;
+    case ALG_SSTF: {
+        if (hs->weigh) {
+            p = weighted_nearest(hs, c);
+            break;
+        }
+        int l = c->nearest(c, hs->head, DIR_LEFT);
+        int r = c->nearest(c, hs->head, DIR_RIGHT);
+        if (l < 0 || r < 0) {
+            p = l < 0 ? r : l;
+        } else {
+            int dl = hs->head - c->get(c, l)->cyl;
+            int dr = c->get(c, r)->cyl - hs->head;
+            if (dl != dr) p = dl < dr ? l : r;
+            else p = c->rank(c, l) < c->rank(c, r) ? l : r;
+        }
+        break;
+    }
+    case ALG_LOOK:
+        p = c->nearest(c, hs->head, hs->dir);
+        if (p < 0) {
+            hs->dir = back;
+            p = c->nearest(c, hs->head, hs->dir);
+        }
+        break;
+    case ALG_SCAN:
+        p = c->nearest(c, hs->head, hs->dir);
+        if (p < 0) {
+            *travel += abs(edge - hs->head);
+            hs->head = edge;
+            hs->dir = back;
+            p = c->nearest(c, hs->head, hs->dir);
+        }
+        break;
+    case ALG_CSCAN:
+        p = c->nearest(c, hs->head, hs->dir);
+        if (p < 0) {
+            *travel += abs(edge - hs->head) + NUM_CYLINDERS - 1;
+            hs->head = NUM_CYLINDERS - 1 - edge;
+            p = c->nearest(c, hs->head, hs->dir);
+        }
+        break;
+    case ALG_DEADLINE:
+        p = c->expiring(c);
+        fifo = 1;
+        if (c->get(c, p)->deadline > hs->now) {
+            p = c->nearest(c, hs->head, DIR_RIGHT);
+            if (p < 0) p = c->nearest(c, 0, DIR_RIGHT);
+            fifo = 0;
+        }
+        break;
+    default: // ALG_CLOOK
+        p = c->nearest(c, hs->head, hs->dir);
+        if (p < 0) {
+            // farthest behind the head = nearest from the far edge
+            p = c->nearest(c, NUM_CYLINDERS - 1 - edge, hs->dir);
+        }
+        break;
+    }
+
+    if (!fifo && hs->weigh && hs->weigh->headSwitch > 0)
+        p = surface_order(hs, c, p);
+
+    *travel += abs(c->get(c, p)->cyl - hs->head);
+    hs->head = c->get(c, p)->cyl;
+    hs->surface = c->get(c, p)->surface;
+    return p;
+}
+
+/****************************************************************
+ * dispatch_ordered
+ * Services n requests through pick_next, offering it only the
+ * requests whose ordering constraints are satisfied (the DAG
+ * ready set). Sweeps therefore run within barrier epochs.
+ * Fills order[] with arrival indices; returns total movement.
+ ****************************************************************/
+int dispatch_ordered(const IoRequest r[], int n, HeadState hs,
+                     int order[]) {
+    int done[NUM_REQUESTS] = {0};
+    int cand[NUM_REQUESTS];
+    IoRequest ready[NUM_REQUESTS];
+    int travel = 0;
+
+    for (int k = 0; k < n; k++) {
+        int m = 0;
+        int pendingBefore = 0;   // unserviced requests seen so far
+
+        for (int i = 0; i < n; i++) {
+            if (done[i]) continue;
+            int ok = (r[i].dep < 0 || done[r[i].dep])
+                  && !((r[i].flags & (REQ_BARRIER | REQ_FUA))
+                       && pendingBefore);
+            if (ok) {
+                cand[m] = i;
+                ready[m++] = r[i];
+            }
+            pendingBefore++;
+            if (r[i].flags & REQ_BARRIER) break;  // nothing passes it
+        }
+
+        Candidates c = array_candidates(ready, m);
+        order[k] = cand[pick_next(&hs, &c, &travel)];
+        done[order[k]] = 1;
+    }
+    return travel;
+}
+
+/****************************************************************
+ * Online simulator
+ * Event loop that replays a Workload against one disk arm. The
+ * queue holds everything that has arrived and not been served;
+ * each dispatch asks pick_next for the next request and advances
+ * the clock by the DiskModel's access time. Times are in ms.
+ ****************************************************************/
+#define SIM_GAP          5.0    // default trace interarrival time
+#define SIM_PASSES       50     // default trace replays
+
+/****************************************************************
+ * Workload
+ * Source of arrivals for the simulator:
+ *   - next_time: arrival time of the next request, or INFINITY
+ *                when no more arrivals are currently scheduled
+ *   - take:      removes and returns that request
+ *   - complete:  completion notice (may be NULL)
+ ****************************************************************/
+typedef struct Workload Workload;
+struct Workload {
+    double (*next_time)(Workload *w);
+    IoRequest (*take)(Workload *w);
+    void (*complete)(Workload *w, const IoRequest *r, double now);
+    void *state;
+};
+
+/****************************************************************
+ * TraceWorkload
+ * Open-loop replay of request.bin `passes` times, one arrival
+ * every `gap` ms, each request `sectors` long, on a surface
+ * hashed from its arrival index when `surfaces` is above 1.
+ ****************************************************************/
+typedef struct {
+    const int *req;
+    int next, total;
+    int sectors;
+    int surfaces;
+    double gap;
+} TraceReplay;
+
+double trace_next_time(Workload *w) {
+    TraceReplay *t = (TraceReplay *)w->state;
+    return t->next < t->total ? t->next * t->gap : INFINITY;
+}
+
+IoRequest trace_take(Workload *w) {
+    TraceReplay *t = (TraceReplay *)w->state;
+    IoRequest r;
+    memset(&r, 0, sizeof(r));
+    r.cyl = t->req[t->next % NUM_REQUESTS];
+    r.dep = -1;
+    r.sectors = t->sectors;
+    unsigned long long h = (unsigned long long)t->next;
+    r.surface = (int)(rng_next(&h) % (unsigned long long)t->surfaces);
+    r.arrival = t->next * t->gap;
+    t->next++;
+    return r;
+}
+
+Workload trace_workload(TraceReplay *t, const int req[], int passes,
+                        double gap) {
+    t->req = req;
+    t->next = 0;
+    t->total = passes * NUM_REQUESTS;
+    t->sectors = SIM_SECTORS;
+    t->surfaces = 1;
+    t->gap = gap;
+    Workload w = { trace_next_time, trace_take, NULL, t };
+    return w;
+}
+
+/****************************************************************
+ * Background
+ * Internal traffic mixed into the dispatch loop:
+ *   - BG_SCRUB:   sequential media scrub, one cylinder at a time
+ *   - BG_REBUILD: RAID rebuild walking stripes `stride` apart
+ * Injected after every `every` foreground dispatches, or only
+ * into idle slots (empty queue) when every is 0.
+ ****************************************************************/
+typedef enum { BG_NONE, BG_SCRUB, BG_REBUILD } BackgroundKind;
+
+#define REBUILD_STRIDE 16
+#define BG_SECTORS     128   // 64 KiB per background read
+
+typedef struct {
+    BackgroundKind kind;
+    int every;
+    int pos;
+    int sinceLast;
+} Background;
+
+IoRequest background_next(Background *bg, double now) {
+    IoRequest r;
+    memset(&r, 0, sizeof(r));
+    r.cyl = bg->pos;
+    r.flags = REQ_BACKGROUND;
+    r.dep = -1;
+    r.sectors = BG_SECTORS;
+    r.arrival = now;
+
+    int stride = bg->kind == BG_SCRUB ? 1 : REBUILD_STRIDE;
+    bg->pos += stride;
+    if (bg->pos >= NUM_CYLINDERS)
+        bg->pos = (bg->pos + 1) % stride;   // next stripe offset
+    return r;
+}
+
+/****************************************************************
+ * CylQueue
+ * Pending requests bucketed by cylinder. Each bucket is a FIFO,
+ * a CylSet marks the non-empty buckets, and a doubly linked list
+ * threads every request in arrival order. The nearest request in
+ * a direction is the head of the bucket found by one CylSet
+ * scan, so dispatch cost does not grow with queue depth - the
+ * closed-loop mode keeps one request per client queued.
+ *
+ * Reads and writes are also threaded on their own arrival-order
+ * FIFOs, as in mq-deadline. Deadlines are arrival plus a fixed
+ * per-direction expiry, so the earliest deadline is at the head
+ * of one of the two.
+ *
+ * pick_next normally takes the head of a bucket (the earliest
+ * arrival on that cylinder); surface-aware picks may take a later
+ * one, which cylq_remove unlinks by walking the bucket.
+ *
+ * With deep queues (a bucket holds queue depth / NUM_CYLINDERS
+ * requests) every bucket link is a cache and TLB miss, and a
+ * prefetch cursor walking the bucket would stall on the same
+ * links. Instead each node keeps a jump pointer to the node
+ * pfDist links further down its bucket (Luk and Mowry), set on
+ * push from a per-bucket ring of the last pfDist pushes, and
+ * removing a bucket head prefetches its jump target. That only
+ * pays for policies that drain a bucket once they reach its
+ * cylinder; a queue starts with pfDist 0 and sched_init turns it
+ * on for those, at DISK_SCHED_PREFETCH (0 disables it, default
+ * PREFETCH_DISTANCE). BENCH measures the best distance per policy.
+ ****************************************************************/
+#define PREFETCH_DISTANCE 8
+#define PREFETCH_MAX      256
+
+typedef struct {
+    IoRequest r;
+    long long seq;          // arrival rank
+    int bnext;              // next in bucket, or free list link
+    int gprev, gnext;       // arrival-order list
+    int dprev, dnext;       // arrival order among reads or writes
+    int jump;               // pfDist links down the bucket, or -1
+} QueueNode;
+
+typedef struct {
+    QueueNode *node;
+    int cap, len, freeList;
+    int ghead, gtail;
+    int dhead[2], dtail[2];   // read and write FIFOs
+    long long nextSeq;
+    int bhead[NUM_CYLINDERS], btail[NUM_CYLINDERS], blen[NUM_CYLINDERS];
+    CylSet occ;
+    int pfDist;                        // prefetch distance in bucket links
+    unsigned bpushed[NUM_CYLINDERS];   // pushes per bucket, for the ring
+    int *recent;                       // per bucket, last pfDist pushes
+} CylQueue;
+
+int prefetch_distance(void) {
+    const char *env = getenv("DISK_SCHED_PREFETCH");
+    int d = env ? atoi(env) : PREFETCH_DISTANCE;
+    if (d < 0) d = 0;
+    return d > PREFETCH_MAX ? PREFETCH_MAX : d;
+}
+
+/* Sets the jump pointer distance; the queue must be empty. */
+void cylq_set_prefetch(CylQueue *q, int dist) {
+    free(q->recent);
+    q->pfDist = dist;
+    q->recent = dist ? malloc(NUM_CYLINDERS * dist * sizeof(int)) : NULL;
+}
+
+void cylq_init(CylQueue *q) {
+    memset(q, 0, sizeof(*q));
+    q->freeList = q->ghead = q->gtail = -1;
+    q->dhead[0] = q->dhead[1] = q->dtail[0] = q->dtail[1] = -1;
+    for (int c = 0; c < NUM_CYLINDERS; c++)
+        q->bhead[c] = q->btail[c] = -1;
+}
+
+void cylq_free(CylQueue *q) {
+    free(q->node);
+    free(q->recent);
+}
+
+void cylq_push(CylQueue *q, IoRequest r) {
+    if (q->freeList < 0) {
+        int old = q->cap;
+        q->cap = q->cap ? 2 * q->cap : 64;
+        q->node = realloc(q->node, q->cap * sizeof(QueueNode));
+        for (int i = q->cap - 1; i >= old; i--) {
+            q->node[i].bnext = q->freeList;
+            q->freeList = i;
+        }
+    }
+
+    int h = q->freeList;
+    QueueNode *n = &q->node[h];
+    q->freeList = n->bnext;
+
+    n->r = r;
+    n->seq = q->nextSeq++;
+    n->bnext = -1;
+    n->gprev = q->gtail;
+    n->gnext = -1;
+    n->jump = -1;
+
+    if (q->gtail >= 0) q->node[q->gtail].gnext = h;
+    else q->ghead = h;
+    q->gtail = h;
+
+    int d = (r.flags & REQ_WRITE) != 0;
+    n->dprev = q->dtail[d];
+    n->dnext = -1;
+    if (q->dtail[d] >= 0) q->node[q->dtail[d]].dnext = h;
+    else q->dhead[d] = h;
+    q->dtail[d] = h;
+
+    if (q->btail[r.cyl] >= 0) q->node[q->btail[r.cyl]].bnext = h;
+    else q->bhead[r.cyl] = h;
+    q->btail[r.cyl] = h;
+
+    if (q->pfDist > 0) {
+        int *slot = &q->recent[r.cyl * q->pfDist
+                               + q->bpushed[r.cyl]++ % q->pfDist];
+        if (q->blen[r.cyl] >= q->pfDist)   // still queued, pfDist back
+            q->node[*slot].jump = h;
+        *slot = h;
+    }
+    q->blen[r.cyl]++;
+
+    cylset_add(&q->occ, r.cyl);
+    q->len++;
+}
+
+/* A QueueNode straddles two cache lines; fetch both. */
+void prefetch_node(const QueueNode *n) {
+    __builtin_prefetch(n, 1);
+    __builtin_prefetch((const char *)(n + 1) - 1, 1);
+}
+
+IoRequest cylq_remove(CylQueue *q, int h) {
+    QueueNode *n = &q->node[h];
+    int c = n->r.cyl;
+
+    int prev = -1;
+    for (int b = q->bhead[c]; b != h; b = q->node[b].bnext) prev = b;
+    if (prev >= 0) q->node[prev].bnext = n->bnext;
+    else q->bhead[c] = n->bnext;
+    if (q->btail[c] == h) q->btail[c] = prev;
+    if (q->bhead[c] < 0) cylset_remove(&q->occ, c);
+    q->blen[c]--;
+    // jump pointers only ever feed prefetches, so the ones a
+    // mid-bucket removal leaves one link off are harmless
+    if (prev < 0 && n->jump >= 0) prefetch_node(&q->node[n->jump]);
+
+    if (n->gprev >= 0) q->node[n->gprev].gnext = n->gnext;
+    else q->ghead = n->gnext;
+    if (n->gnext >= 0) q->node[n->gnext].gprev = n->gprev;
+    else q->gtail = n->gprev;
+
+    int d = (n->r.flags & REQ_WRITE) != 0;
+    if (n->dprev >= 0) q->node[n->dprev].dnext = n->dnext;
+    else q->dhead[d] = n->dnext;
+    if (n->dnext >= 0) q->node[n->dnext].dprev = n->dprev;
+    else q->dtail[d] = n->dprev;
+
+    n->bnext = q->freeList;
+    q->freeList = h;
+    q->len--;
+    return n->r;
+}
+
+int cylq_first(const Candidates *c) {
+    return ((const CylQueue *)c->set)->ghead;
+}
+
+int cylq_nearest(const Candidates *c, int head, Direction dir) {
+    const CylQueue *q = (const CylQueue *)c->set;
+    int cyl = dir == DIR_RIGHT ? cylset_succ(&q->occ, head)
+                               : cylset_pred(&q->occ, head + 1);
+    return cyl < 0 ? -1 : q->bhead[cyl];
+}
+
+/* Walks the bucket heads in cylinder order. */
+int cylq_after(const Candidates *c, int h) {
+    const CylQueue *q = (const CylQueue *)c->set;
+    int cyl = cylset_succ(&q->occ, h < 0 ? 0 : q->node[h].r.cyl + 1);
+    return cyl < 0 ? -1 : q->bhead[cyl];
+}
+
+const IoRequest *cylq_get(const Candidates *c, int h) {
+    return &((const CylQueue *)c->set)->node[h].r;
+}
+
+long long cylq_rank(const Candidates *c, int h) {
+    return ((const CylQueue *)c->set)->node[h].seq;
+}
+
+int cylq_sibling(const Candidates *c, int h) {
+    return ((const CylQueue *)c->set)->node[h].bnext;
+}
+
+int cylq_expiring(const Candidates *c) {
+    const CylQueue *q = (const CylQueue *)c->set;
+    int r = q->dhead[0], w = q->dhead[1];
+    if (r < 0 || w < 0) return r < 0 ? w : r;
+    const QueueNode *a = &q->node[r], *b = &q->node[w];
+    if (a->r.deadline != b->r.deadline)
+        return a->r.deadline < b->r.deadline ? r : w;
+    return a->seq < b->seq ? r : w;
+}
+
+Candidates cylq_candidates(const CylQueue *q) {
+    Candidates c = { cylq_first, cylq_nearest, cylq_after, cylq_get,
+                     cylq_rank, cylq_sibling, cylq_expiring, q, q->len };
+    return c;
+}
+
+/****************************************************************
+ * SimStats
+ * Foreground latencies (kept for percentiles), head movement (in
+ * total and on background requests) and the number of background
+ * requests served.
+ ****************************************************************/
+typedef struct {
+    double *lat;
+    int n, cap;
+    long long movement;
+    long long bgMovement;
+    int background;
+    double end;
+} SimStats;
+
+void stats_add(SimStats *st, double latency) {
+    if (st->n == st->cap) {
+        st->cap = st->cap ? 2 * st->cap : 256;
+        st->lat = realloc(st->lat, st->cap * sizeof(double));
+    }
+    st->lat[st->n++] = latency;
+}
+
+int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* p-th percentile (0..100) of the recorded latencies. Sorts. */
+double stats_percentile(SimStats *st, double p) {
+    if (st->n == 0) return 0;
+    qsort(st->lat, st->n, sizeof(double), cmp_double);
+    int k = (int)ceil(p / 100.0 * st->n) - 1;
+    return st->lat[k < 0 ? 0 : k];
+}
+
+double stats_mean(const SimStats *st) {
+    double sum = 0;
+    for (int i = 0; i < st->n; i++) sum += st->lat[i];
+    return st->n ? sum / st->n : 0;
+}
+
+/****************************************************************
+ * EventHeap
+ * Binary min-heap of (time, id) events for the closed-loop
+ * clients: each simulated client is just an id and a wake time,
+ * so 100k clients cost a few MB and O(log N) per event.
+ ****************************************************************/
+typedef struct {
+    double t;
+    int id;
+} Event;
+
+typedef struct {
+    Event *e;
+    int n, cap;
+} EventHeap;
+
+void heap_push(EventHeap *h, double t, int id) {
+    if (h->n == h->cap) {
+        h->cap = h->cap ? 2 * h->cap : 256;
+        h->e = realloc(h->e, h->cap * sizeof(Event));
+    }
+    int i = h->n++;
+    while (i > 0 && h->e[(i - 1) / 2].t > t) {
+        h->e[i] = h->e[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    h->e[i].t = t;
+    h->e[i].id = id;
+}
+
+Event heap_pop(EventHeap *h) {
+    Event top = h->e[0];
+    Event last = h->e[--h->n];
+    int i = 0;
+    for (;;) {
+        int c = 2 * i + 1;
+        if (c >= h->n) break;
+        if (c + 1 < h->n && h->e[c + 1].t < h->e[c].t) c++;
+        if (h->e[c].t >= last.t) break;
+        h->e[i] = h->e[c];
+        i = c;
+    }
+    if (h->n > 0) h->e[i] = last;
+    return top;
+}
+
+/****************************************************************
+ * ClosedLoop workload
+ * N clients, each a tiny state machine:
+ *   THINK --(wake)--> ISSUE --(take)--> WAIT --(complete)--> THINK
+ * A thinking client sits in the heap until its wake time; a
+ * waiting one is only referenced by its queued request's tag.
+ * Client c walks the trace from position c, and think times are
+ * exponential with the given mean. Each client issues `each`
+ * requests.
+ ****************************************************************/
+typedef struct {
+    const int *req;
+    int *cursor;        // next trace position per client
+    int *left;          // requests still to issue per client
+    EventHeap wake;
+    double think;
+    unsigned long long rng;
+} ClosedLoop;
+
+double think_time(ClosedLoop *cl) {
+    return -cl->think * log(1.0 - rng_unit(&cl->rng));
+}
+
+double closed_next_time(Workload *w) {
+    ClosedLoop *cl = (ClosedLoop *)w->state;
+    return cl->wake.n ? cl->wake.e[0].t : INFINITY;
+}
+
+IoRequest closed_take(Workload *w) {
+    ClosedLoop *cl = (ClosedLoop *)w->state;
+    Event ev = heap_pop(&cl->wake);
+    IoRequest r;
+    memset(&r, 0, sizeof(r));
+    r.cyl = cl->req[cl->cursor[ev.id]];
+    r.dep = -1;
+    r.sectors = SIM_SECTORS;
+    r.arrival = ev.t;
+    r.tag = ev.id;
+    cl->cursor[ev.id] = (cl->cursor[ev.id] + 1) % NUM_REQUESTS;
+    cl->left[ev.id]--;
+    return r;
+}
+
+void closed_complete(Workload *w, const IoRequest *r, double now) {
+    ClosedLoop *cl = (ClosedLoop *)w->state;
+    if (cl->left[r->tag] > 0)
+        heap_push(&cl->wake, now + think_time(cl), r->tag);
+}
+
+Workload closed_workload(ClosedLoop *cl, const int req[], int clients,
+                         int each, double think) {
+    cl->req = req;
+    cl->cursor = malloc(clients * sizeof(int));
+    cl->left = malloc(clients * sizeof(int));
+    memset(&cl->wake, 0, sizeof(cl->wake));
+    cl->think = think;
+    cl->rng = 0xC1057ULL;
+
+    for (int c = 0; c < clients; c++) {
+        cl->cursor[c] = c % NUM_REQUESTS;
+        cl->left[c] = each;
+        heap_push(&cl->wake, think_time(cl), c);
+    }
+    Workload w = { closed_next_time, closed_take, closed_complete, cl };
+    return w;
+}
+
+void closed_free(ClosedLoop *cl) {
+    free(cl->cursor);
+    free(cl->left);
+    free(cl->wake.e);
+}
+
+/****************************************************************
+ * fio job-file import
+ * Parses the common fio options and turns every job into a lazy
+ * request generator. Supported options (others are ignored):
+ *   rw/readwrite  read, write, randread, randwrite, rw/readwrite,
+ *                 randrw
+ *   rwmixread     read percentage for mixed patterns (default 50;
+ *                 rwmixwrite sets its complement), applied after
+ *                 parsing so it holds wherever it appears
+ *   bs            block size
+ *   iodepth       requests kept in flight per job
+ *   numjobs       clones of the job
+ *   offset, size  byte range of the job (or % of the disk)
+ *   number_ios    stop after this many ios (default size / bs)
+ *   random_distribution  random, zipf:<theta> (theta > 0, != 1),
+ *                 pareto:<h> (0 < h < 1)
+ *   thinktime     usecs between completing and issuing
+ *   sync          1 marks writes synchronous
+ * Byte offsets map to cylinders at FIO_BYTES_PER_CYL each.
+ ****************************************************************/
+#define FIO_BYTES_PER_CYL (64LL << 20)
+#define FIO_DISK_BYTES    (NUM_CYLINDERS * FIO_BYTES_PER_CYL)
+#define MAX_FIO_JOBS      64
+
+typedef enum { DIST_UNIFORM, DIST_ZIPF, DIST_PARETO } RandomDist;
+
+typedef struct {
+    char name[64];
+    int random, readPct, sync;
+    int mixed, mixPct;  // rw/randrw; rwmixread, -1 if unset
+    long long bs, offset, size, numIos;
+    int iodepth, numjobs;
+    RandomDist dist;
+    double distParam;
+    double zetaN;       // zipf normalizer, computed once per job
+    double thinkMs;
+} FioJob;
+
+void fio_job_defaults(FioJob *j) {
+    memset(j, 0, sizeof(*j));
+    j->readPct = 100;
+    j->mixPct = -1;
+    j->bs = 4096;
+    j->size = FIO_DISK_BYTES;
+    j->iodepth = 1;
+    j->numjobs = 1;
+}
+
+/* Parses sizes like 4k, 1m, 2g (base 1024) or n% of the disk. */
+long long fio_size(const char *v) {
+    char *end;
+    double x = strtod(v, &end);
+    switch (*end) {
+    case 'k': case 'K': return (long long)(x * 1024);
+    case 'm': case 'M': return (long long)(x * 1024 * 1024);
+    case 'g': case 'G': return (long long)(x * 1024 * 1024 * 1024);
+    case 't': case 'T': return (long long)(x * 1024 * 1024 * 1024 * 1024);
+    case '%': return (long long)(x / 100 * FIO_DISK_BYTES);
+    default:  return (long long)x;
+    }
+}
+
+/* Applies one option; returns 0 if the value is invalid. */
+int fio_option(FioJob *j, const char *key, const char *val) {
+    if (!strcmp(key, "rw") || !strcmp(key, "readwrite")) {
+        j->random = strncmp(val, "rand", 4) == 0;
+        const char *op = j->random ? val + 4 : val;
+        j->mixed = !strcmp(op, "rw") || !strcmp(op, "readwrite");
+        if (!strcmp(op, "read")) j->readPct = 100;
+        else if (!strcmp(op, "write")) j->readPct = 0;
+        else if (j->mixed) j->readPct = 50;
+        else return 0;
+    }
+    else if (!strcmp(key, "rwmixread") || !strcmp(key, "rwmixwrite")) {
+        int pct = atoi(val);
+        if (pct < 0 || pct > 100) return 0;
+        j->mixPct = !strcmp(key, "rwmixread") ? pct : 100 - pct;
+    }
+    else if (!strcmp(key, "bs")) j->bs = fio_size(val);
+    else if (!strcmp(key, "iodepth")) j->iodepth = atoi(val);
+    else if (!strcmp(key, "numjobs")) j->numjobs = atoi(val);
+    else if (!strcmp(key, "offset")) j->offset = fio_size(val);
+    else if (!strcmp(key, "size")) j->size = fio_size(val);
+    else if (!strcmp(key, "number_ios")) j->numIos = atoll(val);
+    else if (!strcmp(key, "thinktime")) j->thinkMs = atof(val) / 1000;
+    else if (!strcmp(key, "sync")) j->sync = atoi(val) != 0;
+    else if (!strcmp(key, "random_distribution")) {
+        if (!strcmp(val, "random")) j->dist = DIST_UNIFORM;
+        else if (!strncmp(val, "zipf:", 5)) j->dist = DIST_ZIPF;
+        else if (!strncmp(val, "pareto:", 7)) j->dist = DIST_PARETO;
+        else return 0;
+        if (j->dist != DIST_UNIFORM) {
+            char *end;
+            double p = strtod(strchr(val, ':') + 1, &end);
+            if (*end != '\0') return 0;
+            // zipf theta = 1 has alpha = 1 / (1 - theta) = inf;
+            // pareto needs log(h) and log(1 - h) finite
+            if (j->dist == DIST_ZIPF ? p <= 0 || p == 1 : p <= 0 || p >= 1)
+                return 0;
+            j->distParam = p;
+        }
+    }
+    return 1;
+}
+
+/****************************************************************
+ * parse_fio_file
+ * Reads a job file into jobs[]. Options in [global] apply to the
+ * jobs that follow it. Returns the job count, or -1 on error.
+ ****************************************************************/
+int parse_fio_file(const char *path, FioJob jobs[], int maxJobs) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        perror("ERROR opening fio job file");
+        return -1;
+    }
+
+    FioJob global, *cur = NULL;
+    fio_job_defaults(&global);
+    int n = 0;
+    char line[512];
+
+    while (fgets(line, sizeof(line), fp)) {
+        char *s = line + strspn(line, " \t");
+        s[strcspn(s, "\r\n#;")] = '\0';
+        char *e = s + strlen(s);
+        while (e > s && (e[-1] == ' ' || e[-1] == '\t'))
+            *--e = '\0';
+        if (*s == '\0') continue;
+
+        if (*s == '[') {
+            s[strcspn(s, "]")] = '\0';
+            if (!strcmp(s + 1, "global")) {
+                cur = &global;
+            } else if (n == maxJobs) {
+                fprintf(stderr, "ERROR: More than %d fio jobs.\n", maxJobs);
+                fclose(fp);
+                return -1;
+            } else {
+                cur = &jobs[n++];
+                *cur = global;
+                snprintf(cur->name, sizeof(cur->name), "%s", s + 1);
+            }
+            continue;
+        }
+
+        char *val = strchr(s, '=');
+        if (val) {
+            char *k = val;
+            while (k > s && (k[-1] == ' ' || k[-1] == '\t')) k--;
+            *k = '\0';
+            val++;
+            val += strspn(val, " \t");
+        } else {
+            val = "1";   // bare flag
+        }
+
+        if (!cur || !fio_option(cur, s, val)) {
+            fprintf(stderr, "ERROR: Bad fio option %s=%s.\n", s, val);
+            fclose(fp);
+            return -1;
+        }
+    }
+    fclose(fp);
+
+    for (int i = 0; i < n; i++) {
+        FioJob *j = &jobs[i];
+        if (j->mixed && j->mixPct >= 0) j->readPct = j->mixPct;
+        if (j->offset + j->size > FIO_DISK_BYTES)
+            j->size = FIO_DISK_BYTES - j->offset;
+        if (j->bs <= 0 || j->size < j->bs || j->iodepth < 1
+            || j->numjobs < 1) {
+            fprintf(stderr, "ERROR: fio job %s has an invalid range.\n",
+                    j->name);
+            return -1;
+        }
+        if (j->dist == DIST_ZIPF) {
+            long long blocks = j->size / j->bs;
+            for (long long b = 1; b <= blocks; b++)
+                j->zetaN += pow((double)b, -j->distParam);
+        }
+    }
+    return n;
+}
+
+/****************************************************************
+ * FioStream
+ * Lazy generator for one job clone: produces the next block on
+ * demand. Zipf ranks use the Gray et al. generator (one zeta
+ * precomputation per stream) and are hashed across the range,
+ * as fio does, so hot blocks are not all at the start.
+ ****************************************************************/
+typedef struct {
+    const FioJob *job;
+    long long blocks, next;
+    long long left;     // ios not yet claimed by a slot
+    double alpha, eta;
+    unsigned long long rng;
+} FioStream;
+
+void fio_stream_init(FioStream *fs, const FioJob *j, int clone) {
+    memset(fs, 0, sizeof(*fs));
+    fs->job = j;
+    fs->blocks = j->size / j->bs;
+    fs->left = j->numIos ? j->numIos : fs->blocks;
+    fs->rng = fnv1a(FNV_OFFSET, j->name, strlen(j->name)) + clone;
+
+    if (j->dist == DIST_ZIPF) {
+        double theta = j->distParam;
+        double zeta2 = 1 + pow(0.5, theta);
+        fs->alpha = 1 / (1 - theta);
+        fs->eta = (1 - pow(2.0 / fs->blocks, 1 - theta))
+                / (1 - zeta2 / j->zetaN);
+    }
+}
+
+long long fio_stream_block(FioStream *fs) {
+    const FioJob *j = fs->job;
+    if (!j->random)
+        return fs->next++ % fs->blocks;
+
+    double u = rng_unit(&fs->rng);
+    double uz = u * j->zetaN;
+    unsigned long long rank;
+
+    switch (j->dist) {
+    case DIST_ZIPF:
+        if (uz < 1) rank = 0;
+        else if (uz < 1 + pow(0.5, j->distParam)) rank = 1;
+        else rank = (unsigned long long)(fs->blocks
+                        * pow(fs->eta * u - fs->eta + 1, fs->alpha));
+        break;
+    case DIST_PARETO:
+        // fio's pareto: u^(log h / log(1 - h)) of the range
+        rank = (unsigned long long)(fs->blocks
+                   * pow(u, log(j->distParam) / log(1 - j->distParam)));
+        break;
+    default:
+        return (long long)(u * fs->blocks);
+    }
+
+    // scatter ranks over the range so hot blocks are not adjacent
+    return (long long)(rng_next(&rank) % (unsigned long long)fs->blocks);
+}
+
+/****************************************************************
+ * FioWorkload
+ * Each job clone keeps up to iodepth requests in flight: slots
+ * wake from an EventHeap (after thinktime), draw the next block
+ * from the clone's stream and wait for completion, exactly like
+ * the closed-loop clients. The request tag is the clone index.
+ ****************************************************************/
+typedef struct {
+    FioStream *streams;
+    int count;
+    EventHeap wake;
+    unsigned long long rng;
+} FioWorkload;
+
+double fio_next_time(Workload *w) {
+    FioWorkload *fw = (FioWorkload *)w->state;
+    return fw->wake.n ? fw->wake.e[0].t : INFINITY;
+}
+
+IoRequest fio_take(Workload *w) {
+    FioWorkload *fw = (FioWorkload *)w->state;
+    Event ev = heap_pop(&fw->wake);
+    FioStream *fs = &fw->streams[ev.id];
+    const FioJob *j = fs->job;
+
+    long long byte = j->offset + fio_stream_block(fs) * j->bs;
+    IoRequest r;
+    memset(&r, 0, sizeof(r));
+    r.cyl = (int)(byte / FIO_BYTES_PER_CYL);
+    r.lba = byte / 512;
+    r.dep = -1;
+    r.sectors = (int)((j->bs + 511) / 512);
+    r.arrival = ev.t;
+    r.tag = ev.id;
+    if (rng_unit(&fw->rng) * 100 >= j->readPct) {
+        r.flags |= REQ_WRITE;
+        if (j->sync) r.flags |= REQ_SYNC;
+    }
+    return r;
+}
+
+/* A completing slot claims the clone's next io, if any is left. */
+void fio_complete(Workload *w, const IoRequest *r, double now) {
+    FioWorkload *fw = (FioWorkload *)w->state;
+    FioStream *fs = &fw->streams[r->tag];
+    if (fs->left > 0) {
+        fs->left--;
+        heap_push(&fw->wake, now + fs->job->thinkMs, r->tag);
+    }
+}
+
+Workload fio_workload(FioWorkload *fw, const FioJob jobs[], int n) {
+    fw->count = 0;
+    for (int i = 0; i < n; i++) fw->count += jobs[i].numjobs;
+    fw->streams = malloc(fw->count * sizeof(FioStream));
+    memset(&fw->wake, 0, sizeof(fw->wake));
+    fw->rng = 0xF10ULL;
+
+    int id = 0;
+    for (int i = 0; i < n; i++) {
+        for (int c = 0; c < jobs[i].numjobs; c++, id++) {
+            FioStream *fs = &fw->streams[id];
+            fio_stream_init(fs, &jobs[i], c);
+            for (int d = 0; d < jobs[i].iodepth && fs->left > 0; d++) {
+                fs->left--;
+                heap_push(&fw->wake, 0, id);
+            }
+        }
+    }
+    Workload w = { fio_next_time, fio_take, fio_complete, fw };
+    return w;
+}
+
+void fio_free(FioWorkload *fw) {
+    free(fw->streams);
+    free(fw->wake.e);
+}
+
+/****************************************************************
+ * Rearranger
+ * Online counterpart of PLACE: a workload wrapper modelling a
+ * drive that copies hot cylinders into a reserved central band
+ * while it serves the inner workload.
+ *   - heat: per-cylinder counter, +1 per access, halving every
+ *           halfLife ms (decayed lazily on use)
+ *   - band: `band` slots filled organ-pipe around the middle
+ *           cylinder; a cylinder whose heat reaches
+ *           REARR_PROMOTE takes a free slot, or evicts the
+ *           coldest one if it is REARR_HYSTERESIS times hotter
+ *   - migration: a REQ_MIGRATE read at the source then a write
+ *           into the slot, preceded by a write-back home if the
+ *           victim was written to; steps run one at a time
+ *           through the normal dispatch loop, and the mapping
+ *           switches when the last step completes
+ * Foreground requests are redirected to their band copy once it
+ * exists.
+ ****************************************************************/
+#define REARR_BAND       10
+#define REARR_HALF_LIFE  200.0   // ms
+#define REARR_PROMOTE    2.0
+#define REARR_HYSTERESIS 1.5
+#define MAX_BAND         64
+
+typedef struct {
+    Workload inner;
+    int band;
+    double halfLife;
+    double heat[NUM_CYLINDERS], seen[NUM_CYLINDERS];
+    int where[NUM_CYLINDERS];      // current copy of each cylinder
+    int owner[MAX_BAND];           // cylinder held by a slot, or -1
+    int dirty[MAX_BAND];
+    IoRequest steps[4];            // pending migration I/O
+    int nsteps, cur, issued;
+    int target, slot;              // migration in flight
+    double readyAt;
+    int migrations;
+} Rearranger;
+
+double rearr_heat(Rearranger *ra, int cyl, double now) {
+    ra->heat[cyl] *= pow(0.5, (now - ra->seen[cyl]) / ra->halfLife);
+    ra->seen[cyl] = now;
+    return ra->heat[cyl];
+}
+
+void rearr_step(Rearranger *ra, int cyl, int flags, int sectors) {
+    IoRequest *r = &ra->steps[ra->nsteps++];
+    memset(r, 0, sizeof(*r));
+    r->cyl = cyl;
+    r->flags = REQ_BACKGROUND | REQ_MIGRATE | flags;
+    r->dep = -1;
+    r->sectors = sectors;
+}
+
+/* Starts migrating cyl if it is hot enough and a slot is worth it. */
+void rearr_consider(Rearranger *ra, int cyl, int sectors, double now) {
+    if (ra->nsteps || ra->where[cyl] != cyl) return;
+    double h = rearr_heat(ra, cyl, now);
+    if (h < REARR_PROMOTE) return;
+
+    int slot = -1;
+    double coldest = INFINITY;
+    for (int s = 0; s < ra->band; s++) {
+        if (ra->owner[s] < 0) { slot = s; break; }
+        double hs = rearr_heat(ra, ra->owner[s], now);
+        if (hs < coldest) { coldest = hs; slot = s; }
+    }
+    if (ra->owner[slot] >= 0 && h < REARR_HYSTERESIS * coldest) return;
+
+    int dst = placement_cyl(PLACE_ORGAN, slot);
+    ra->cur = ra->issued = 0;
+    if (ra->owner[slot] >= 0 && ra->dirty[slot]) {
+        rearr_step(ra, dst, 0, sectors);
+        rearr_step(ra, ra->owner[slot], REQ_WRITE, sectors);
+    }
+    rearr_step(ra, cyl, 0, sectors);
+    rearr_step(ra, dst, REQ_WRITE, sectors);
+    ra->target = cyl;
+    ra->slot = slot;
+    ra->readyAt = now;
+}
+
+double rearr_next_time(Workload *w) {
+    Rearranger *ra = (Rearranger *)w->state;
+    double t = ra->inner.next_time(&ra->inner);
+    if (ra->nsteps && !ra->issued && ra->readyAt < t) t = ra->readyAt;
+    return t;
+}
+
+IoRequest rearr_take(Workload *w) {
+    Rearranger *ra = (Rearranger *)w->state;
+    if (ra->nsteps && !ra->issued
+        && ra->readyAt <= ra->inner.next_time(&ra->inner)) {
+        IoRequest r = ra->steps[ra->cur];
+        r.arrival = ra->readyAt;
+        ra->issued = 1;
+        return r;
+    }
+
+    IoRequest r = ra->inner.take(&ra->inner);
+    int cyl = r.cyl;
+    rearr_heat(ra, cyl, r.arrival);
+    ra->heat[cyl] += 1;
+
+    r.cyl = ra->where[cyl];
+    if (r.cyl != cyl && (r.flags & REQ_WRITE)) {
+        for (int s = 0; s < ra->band; s++)
+            if (ra->owner[s] == cyl) ra->dirty[s] = 1;
+    }
+    rearr_consider(ra, cyl, r.sectors, r.arrival);
+    return r;
+}
+
+void rearr_complete(Workload *w, const IoRequest *r, double now) {
+    Rearranger *ra = (Rearranger *)w->state;
+    if (!(r->flags & REQ_MIGRATE)) {
+        if (ra->inner.complete) ra->inner.complete(&ra->inner, r, now);
+        return;
+    }
+
+    int s = ra->slot;
+    if (ra->cur == 1 && ra->nsteps == 4) {   // victim written back
+        ra->where[ra->owner[s]] = ra->owner[s];
+        ra->owner[s] = -1;
+        ra->dirty[s] = 0;
+    }
+    if (++ra->cur < ra->nsteps) {
+        ra->issued = 0;
+        ra->readyAt = now;
+        return;
+    }
+
+    if (ra->owner[s] >= 0)                   // clean victim: just drop it
+        ra->where[ra->owner[s]] = ra->owner[s];
+    ra->owner[s] = ra->target;
+    ra->dirty[s] = 0;
+    ra->where[ra->target] = placement_cyl(PLACE_ORGAN, s);
+    ra->nsteps = 0;
+    ra->migrations++;
+}
+
+Workload rearr_workload(Rearranger *ra, Workload inner, int band,
+                        double halfLife) {
+    memset(ra, 0, sizeof(*ra));
+    ra->inner = inner;
+    ra->band = band;
+    ra->halfLife = halfLife;
+    for (int c = 0; c < NUM_CYLINDERS; c++) ra->where[c] = c;
+    for (int s = 0; s < MAX_BAND; s++) ra->owner[s] = -1;
+    Workload w = { rearr_next_time, rearr_take, rearr_complete, ra };
+    return w;
+}
+
+/****************************************************************
+ * Block-layer lock model
+ * Compares the legacy single request queue with the blk-mq
+ * layout on the CPU side of submission, where lock contention
+ * decides scaling:
+ *   - legacy: every CPU takes the one queue lock, which also
+ *             covers the elevator insert
+ *   - blk-mq: each CPU inserts into its own software queue, then
+ *             dispatches through the scheduler (if any) into
+ *             hardware queue cpu % N under that queue's lock
+ * blk-mq-only schedulers (none, mq-deadline, kyber) have no
+ * single-queue figures.
+ * Submitters are simulated CPUs that spend MQ_SUBMIT_NS of
+ * lock-free work per I/O and then walk their lock path. Locks
+ * are FIFO: an acquirer waits until the previous holder's
+ * release. Each CPU's path is resolved in one step in time
+ * order, which is exact for the single shared lock and a close
+ * approximation when paths cross several shared locks.
+ * Times are in ns.
+ ****************************************************************/
+#define MQ_SUBMIT_NS  500.0   // bio setup, tag allocation, ...
+#define MQ_SWQ_NS      40.0   // per-CPU software queue insert
+#define MQ_HWQ_NS      80.0   // hardware queue dispatch
+#define SQ_QUEUE_NS   250.0   // legacy queue_lock critical section
+#define MQ_REQUESTS   10000   // default submissions per CPU
+#define MAX_MQ_CPUS   1024
+
+typedef enum { SCOPE_NONE, SCOPE_GLOBAL, SCOPE_PER_HCTX } LockScope;
+
+typedef struct {
+    const char *name;
+    LockScope scope;
+    int legacy;        // also runs on the single queue
+    double insertNs;   // insert under a per-CPU scheduler lock
+    double holdNs;     // scheduler work under its scope's lock
+} MqScheduler;
+
+/* kyber inserts into per-CPU lists under their own locks and only
+ * takes the per-hctx lock to pick a domain and dispatch. The
+ * classic algorithms run as elevators behind one lock. FCFS
+ * appends; SSTF, SCAN, C-SCAN, LOOK and C-LOOK share the CylQueue
+ * bucket insert and CylSet dispatch, so they are one row: the
+ * model has no cost that tells them apart. */
+const MqScheduler MQ_SCHEDULERS[] = {
+    { "none",        SCOPE_NONE,     0,  0.0,   0.0 },
+    { "mq-deadline", SCOPE_GLOBAL,   0,  0.0, 150.0 },
+    { "kyber",       SCOPE_PER_HCTX, 0, 30.0,  50.0 },
+    { "FCFS",        SCOPE_GLOBAL,   1,  0.0,  60.0 },
+    { "elevator",    SCOPE_GLOBAL,   1,  0.0, 200.0 },
+};
+
+typedef struct {
+    double freeAt;
+    double waitNs;
+    long long acquired, contended;
+} LockModel;
+
+/* Takes l at time t for hold ns; returns the release time. */
+double lock_take(LockModel *l, double t, double hold) {
+    double start = t > l->freeAt ? t : l->freeAt;
+    if (start > t) {
+        l->contended++;
+        l->waitNs += start - t;
+    }
+    l->acquired++;
+    l->freeAt = start + hold;
+    return l->freeAt;
+}
+
+typedef struct {
+    double throughput;   // submissions per second
+    double waitNs;       // mean lock wait per submission
+    double contended;    // share of acquisitions that waited
+} MqResult;
+
+/****************************************************************
+ * simulate_submission
+ * Runs cpus submitters for `each` I/Os apiece. hwq = 0 models
+ * the legacy single queue.
+ ****************************************************************/
+MqResult simulate_submission(const MqScheduler *sch, int cpus, int hwq,
+                             int each) {
+    int nLocks = 1 + 2 * cpus + 2 * (hwq ? hwq : 1);
+    LockModel *locks = calloc(nLocks, sizeof(LockModel));
+    LockModel *queueLock = &locks[0];
+    LockModel *swq = &locks[1];
+    LockModel *hctx = &locks[1 + cpus];
+    LockModel *sched = &locks[1 + cpus + (hwq ? hwq : 1)];
+    LockModel *schedCpu = &locks[1 + cpus + 2 * (hwq ? hwq : 1)];
+
+    EventHeap cpuReady = { NULL, 0, 0 };
+    int *left = malloc(cpus * sizeof(int));
+    for (int c = 0; c < cpus; c++) {
+        left[c] = each;
+        heap_push(&cpuReady, MQ_SUBMIT_NS, c);
+    }
+
+    double end = 0;
+    while (cpuReady.n) {
+        Event ev = heap_pop(&cpuReady);
+        int c = ev.id;
+        double t = ev.t;
+
+        if (hwq == 0) {
+            t = lock_take(queueLock, t, SQ_QUEUE_NS + sch->holdNs);
+        } else {
+            int q = c % hwq;
+            t = lock_take(&swq[c], t, MQ_SWQ_NS);
+            if (sch->insertNs > 0)
+                t = lock_take(&schedCpu[c], t, sch->insertNs);
+            if (sch->scope == SCOPE_GLOBAL)
+                t = lock_take(&sched[0], t, sch->holdNs);
+            else if (sch->scope == SCOPE_PER_HCTX)
+                t = lock_take(&sched[q], t, sch->holdNs);
+            t = lock_take(&hctx[q], t, MQ_HWQ_NS);
+        }
+
+        if (t > end) end = t;
+        if (--left[c] > 0)
+            heap_push(&cpuReady, t + MQ_SUBMIT_NS, c);
+    }
+
+    MqResult r = { 0, 0, 0 };
+    long long acquired = 0, contended = 0;
+    for (int i = 0; i < nLocks; i++) {
+        r.waitNs += locks[i].waitNs;
+        acquired += locks[i].acquired;
+        contended += locks[i].contended;
+    }
+    long long total = (long long)cpus * each;
+    r.throughput = total / (end * 1e-9);
+    r.waitNs /= total;
+    r.contended = acquired ? (double)contended / acquired : 0;
+
+    free(locks);
+    free(left);
+    free(cpuReady.e);
+    return r;
+}
+
+/****************************************************************
+ * Kyber
+ * Token-based dispatch after the Linux Kyber scheduler. Requests
+ * are split into domains (reads, synchronous writes, everything
+ * else), each a FIFO. A domain may only have depth[d] requests
+ * dispatched to the device at once; the device serves what it
+ * was given in order. Every KYBER_WINDOW ms the P90 latency of
+ * each domain is compared with its target: if any domain misses,
+ * the other domains' depths are halved so its requests stop
+ * queueing behind them; otherwise every depth grows by one back
+ * towards its maximum.
+ ****************************************************************/
+#define KYBER_WINDOW   100.0   // ms between depth adjustments
+#define KYBER_SAMPLES  1024    // latency samples kept per window
+
+enum { KY_READ, KY_SYNC_WRITE, KY_OTHER, KY_DOMAINS };
+
+const double KYBER_TARGET[KY_DOMAINS]    = { 20.0, 50.0, INFINITY };
+const int    KYBER_MAX_DEPTH[KY_DOMAINS] = { 16, 8, 4 };
+
+#define KYBER_DEVICE_CAP (16 + 8 + 4)
+
+typedef struct {
+    CylQueue dq[KY_DOMAINS];
+    IoRequest dev[KYBER_DEVICE_CAP];
+    int devHead, devLen;
+    int inflight[KY_DOMAINS], depth[KY_DOMAINS];
+    double lat[KY_DOMAINS][KYBER_SAMPLES];
+    int nlat[KY_DOMAINS];
+    double windowEnd;
+    int rr;
+} KyberState;
+
+int kyber_domain(int flags) {
+    if (flags & REQ_BACKGROUND) return KY_OTHER;
+    if (!(flags & REQ_WRITE)) return KY_READ;
+    return flags & REQ_SYNC ? KY_SYNC_WRITE : KY_OTHER;
+}
+
+void kyber_init(KyberState *ky) {
+    memset(ky, 0, sizeof(*ky));
+    for (int d = 0; d < KY_DOMAINS; d++) {
+        cylq_init(&ky->dq[d]);
+        ky->depth[d] = KYBER_MAX_DEPTH[d];
+    }
+    ky->windowEnd = KYBER_WINDOW;
+}
+
+void kyber_free(KyberState *ky) {
+    for (int d = 0; d < KY_DOMAINS; d++)
+        cylq_free(&ky->dq[d]);
+}
+
+int kyber_pending(const KyberState *ky) {
+    int n = ky->devLen;
+    for (int d = 0; d < KY_DOMAINS; d++) n += ky->dq[d].len;
+    return n;
+}
+
+/* Hands requests to the device, round-robin over domains that
+ * have both queued requests and free tokens. */
+void kyber_fill(KyberState *ky) {
+    int idle = 0;
+    while (idle < KY_DOMAINS) {
+        int d = ky->rr;
+        ky->rr = (ky->rr + 1) % KY_DOMAINS;
+        if (ky->dq[d].len == 0 || ky->inflight[d] >= ky->depth[d]) {
+            idle++;
+            continue;
+        }
+        idle = 0;
+        int slot = (ky->devHead + ky->devLen++) % KYBER_DEVICE_CAP;
+        ky->dev[slot] = cylq_remove(&ky->dq[d], ky->dq[d].ghead);
+        ky->inflight[d]++;
+    }
+}
+
+IoRequest kyber_next(KyberState *ky) {
+    kyber_fill(ky);
+    IoRequest r = ky->dev[ky->devHead];
+    ky->devHead = (ky->devHead + 1) % KYBER_DEVICE_CAP;
+    ky->devLen--;
+    return r;
+}
+
+void kyber_complete(KyberState *ky, const IoRequest *r, double now) {
+    int d = kyber_domain(r->flags);
+    ky->inflight[d]--;
+    if (ky->nlat[d] < KYBER_SAMPLES)
+        ky->lat[d][ky->nlat[d]++] = now - r->arrival;
+
+    if (now < ky->windowEnd) return;
+    ky->windowEnd = now + KYBER_WINDOW;
+
+    unsigned missed = 0;   // bit k: domain k over its target
+    for (int k = 0; k < KY_DOMAINS; k++) {
+        if (ky->nlat[k] == 0) continue;
+        qsort(ky->lat[k], ky->nlat[k], sizeof(double), cmp_double);
+        double p90 = ky->lat[k][(int)ceil(0.9 * ky->nlat[k]) - 1];
+        if (p90 > KYBER_TARGET[k]) missed |= 1u << k;
+        ky->nlat[k] = 0;
+    }
+
+    // throttle only the domains that met their target
+    for (int k = 0; k < KY_DOMAINS; k++) {
+        if (missed && !(missed & 1u << k))
+            ky->depth[k] = ky->depth[k] > 1 ? ky->depth[k] / 2 : 1;
+        else if (!missed && ky->depth[k] < KYBER_MAX_DEPTH[k])
+            ky->depth[k]++;
+    }
+}
+
+/****************************************************************
+ * OnlineSched
+ * The simulator's scheduler layer: Kyber's domain queues, or a
+ * CylQueue dispatched through pick_next for every other policy.
+ * Requests get their deadline-scheduler expiry stamped on entry.
+ ****************************************************************/
+#define DL_READ_EXPIRE  50.0    // ms
+#define DL_WRITE_EXPIRE 500.0
+
+typedef struct {
+    HeadState hs;
+    CylQueue q;
+    KyberState *ky;   // non-NULL for ALG_KYBER
+} OnlineSched;
+
+void sched_init(OnlineSched *s, HeadState hs) {
+    s->hs = hs;
+    cylq_init(&s->q);
+    // FCFS (and Kyber's domain FIFOs) dispatch in arrival order, on
+    // a different cylinder each time, so jump targets never help
+    if (hs.alg != ALG_FCFS && hs.alg != ALG_KYBER)
+        cylq_set_prefetch(&s->q, prefetch_distance());
+    s->ky = NULL;
+    if (hs.alg == ALG_KYBER) {
+        s->ky = malloc(sizeof(KyberState));
+        kyber_init(s->ky);
+    }
+}
+
+void sched_free(OnlineSched *s) {
+    cylq_free(&s->q);
+    if (s->ky) {
+        kyber_free(s->ky);
+        free(s->ky);
+    }
+}
+
+int sched_len(const OnlineSched *s) {
+    return s->ky ? kyber_pending(s->ky) : s->q.len;
+}
+
+void sched_push(OnlineSched *s, IoRequest r) {
+    r.deadline = r.arrival + (r.flags & REQ_WRITE ? DL_WRITE_EXPIRE
+                                                  : DL_READ_EXPIRE);
+    if (s->ky) cylq_push(&s->ky->dq[kyber_domain(r.flags)], r);
+    else cylq_push(&s->q, r);
+}
+
+/* Next request to service at time now; adds the seek to *travel. */
+IoRequest sched_next(OnlineSched *s, double now, int *travel) {
+    if (s->ky) {
+        IoRequest r = kyber_next(s->ky);
+        *travel += abs(r.cyl - s->hs.head);
+        s->hs.head = r.cyl;
+        s->hs.surface = r.surface;
+        return r;
+    }
+    s->hs.now = now;
+    Candidates c = cylq_candidates(&s->q);
+    return cylq_remove(&s->q, pick_next(&s->hs, &c, travel));
+}
+
+void sched_complete(OnlineSched *s, const IoRequest *r, double now) {
+    if (s->ky) kyber_complete(s->ky, r, now);
+}
+
+/****************************************************************
+ * Submission rings
+ * Concurrent front end for the online scheduler: each producer
+ * thread owns a single-producer/single-consumer ring, and one
+ * dispatcher thread drains all rings in batches into its private
+ * OnlineSched. No lock is taken on either side:
+ *   - the producer writes the slot, then publishes it with a
+ *     release store of tail
+ *   - the dispatcher acquires tail, copies up to RING_BATCH
+ *     slots out, then frees them with a release store of head
+ * Each side keeps a cached copy of the other's index and only
+ * reloads it when the ring looks full (or empty), and the two
+ * indices sit on separate cache lines, so in the steady state a
+ * submission touches no line the dispatcher is writing.
+ ****************************************************************/
+#define RING_SLOTS 1024    // power of two
+#define RING_BATCH 64
+#define CACHE_LINE 64
+
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_size_t tail;   // producer side
+    size_t cachedHead;
+    _Alignas(CACHE_LINE) atomic_size_t head;   // dispatcher side
+    size_t cachedTail;
+    _Alignas(CACHE_LINE) IoRequest slot[RING_SLOTS];
+} SubmitRing;
+
+typedef struct {
+    SubmitRing *rings;
+    int producers;
+    int cursor;   // ring the next drain starts at
+} SubmitQueue;
+
+/* aligned_alloc of bytes rounded up to whole cache lines, as C11
+ * requires of the size. */
+void *cache_alloc(size_t bytes) {
+    return aligned_alloc(CACHE_LINE, (bytes + CACHE_LINE - 1)
+                                     & ~(size_t)(CACHE_LINE - 1));
+}
+
+/* Returns 0 if the rings cannot be allocated. */
+int submit_init(SubmitQueue *q, int producers) {
+    q->rings = cache_alloc(producers * sizeof(SubmitRing));
+    if (!q->rings) return 0;
+    q->producers = producers;
+    q->cursor = 0;
+    for (int p = 0; p < producers; p++) {
+        atomic_init(&q->rings[p].tail, 0);
+        atomic_init(&q->rings[p].head, 0);
+        q->rings[p].cachedHead = q->rings[p].cachedTail = 0;
+    }
+    return 1;
+}
+
+void submit_free(SubmitQueue *q) {
+    free(q->rings);
+}
+
+/* Producer side: returns 0 if the ring is full. */
+int submit(SubmitQueue *q, int producer, const IoRequest *r) {
+    SubmitRing *ring = &q->rings[producer];
+    size_t t = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    if (t - ring->cachedHead == RING_SLOTS) {
+        ring->cachedHead =
+            atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (t - ring->cachedHead == RING_SLOTS) return 0;
+    }
+
+    ring->slot[t & (RING_SLOTS - 1)] = *r;
+    atomic_store_explicit(&ring->tail, t + 1, memory_order_release);
+    return 1;
+}
+
+/* Dispatcher side: copies up to max requests out of one ring. */
+int ring_drain(SubmitRing *ring, IoRequest out[], int max) {
+    size_t h = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    if (ring->cachedTail == h) {
+        ring->cachedTail =
+            atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (ring->cachedTail == h) return 0;
+    }
+
+    size_t n = ring->cachedTail - h;
+    if (n > (size_t)max) n = (size_t)max;
+    for (size_t i = 0; i < n; i++)
+        out[i] = ring->slot[(h + i) & (RING_SLOTS - 1)];
+
+    atomic_store_explicit(&ring->head, h + n, memory_order_release);
+    return (int)n;
+}
+
+/*
+ * Drains one batch from every ring, round-robin from the ring
+ * after the last one drained, into the scheduler. Returns the
+ * number of requests moved.
+ */
+int submit_drain(SubmitQueue *q, OnlineSched *s) {
+    IoRequest batch[RING_BATCH];
+    int total = 0;
+
+    for (int k = 0; k < q->producers; k++) {
+        int p = (q->cursor + k) % q->producers;
+        int n = ring_drain(&q->rings[p], batch, RING_BATCH);
+        for (int i = 0; i < n; i++) sched_push(s, batch[i]);
+        total += n;
+    }
+    q->cursor = (q->cursor + 1) % q->producers;
+    return total;
+}
+
+/****************************************************************
+ * NUMA topology and large-array placement
+ * Node CPU lists come from /sys/devices/system/node (no
+ * libnuma; without it the machine is one node of every online
+ * CPU). Placement relies on the kernel's first-touch policy -
+ * a page lands on the node of the thread that first writes it:
+ *   - big_replicate fills one copy per node from a thread
+ *     pinned to that node, for read-only arrays
+ *   - big_interleave writes BIG_CHUNK-sized chunks round-robin
+ *     from threads pinned to each node
+ * big_alloc maps anonymous memory backed by 4 KiB pages,
+ * transparent huge pages (madvise) or hugetlbfs pages
+ * (MAP_HUGETLB; fails unless vm.nr_hugepages reserves enough).
+ ****************************************************************/
+#define MAX_NODES 64
+#define MAX_CPUS  1024
+#define BIG_CHUNK (2UL << 20)   // one x86-64 huge page
+
+typedef enum { PAGES_SMALL, PAGES_THP, PAGES_HUGETLB, NUM_PAGE_KINDS } PageKind;
+
+typedef struct {
+    int nodes;
+    int first[MAX_NODES + 1];   // node k owns cpu[first[k] .. first[k + 1])
+    int cpu[MAX_CPUS];
+} NumaTopology;
+
+/* Parses a sysfs CPU list such as "0-3,8-11". */
+int parse_cpulist(const char *s, int out[], int max) {
+    int n = 0;
+    while (*s && *s != '\n') {
+        char *end;
+        long a = strtol(s, &end, 10), b = a;
+        if (end == s) break;
+        if (*end == '-') b = strtol(end + 1, &end, 10);
+        for (long c = a; c <= b && n < max; c++) out[n++] = (int)c;
+        s = *end == ',' ? end + 1 : end;
+    }
+    return n;
+}
+
+void numa_discover(NumaTopology *t) {
+    char path[64], line[4096];
+    int used = 0;
+    t->nodes = 0;
+    t->first[0] = 0;
+
+    for (int k = 0; k < MAX_NODES; k++) {   // ids may be sparse
+        snprintf(path, sizeof(path),
+                 "/sys/devices/system/node/node%d/cpulist", k);
+        FILE *f = fopen(path, "r");
+        if (!f) continue;
+        int n = fgets(line, sizeof(line), f)
+                ? parse_cpulist(line, t->cpu + used, MAX_CPUS - used) : 0;
+        fclose(f);
+        if (n == 0) continue;               // memory-only node
+        used += n;
+        t->first[++t->nodes] = used;
+    }
+
+    if (t->nodes == 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        if (n < 1) n = 1;
+        if (n > MAX_CPUS) n = MAX_CPUS;
+        for (int c = 0; c < n; c++) t->cpu[c] = c;
+        t->nodes = 1;
+        t->first[1] = (int)n;
+    }
+}
+
+/* Workers go round-robin over the nodes, then over each node's CPUs. */
+int numa_worker_node(const NumaTopology *t, int worker) {
+    return worker % t->nodes;
+}
+
+int numa_worker_cpu(const NumaTopology *t, int worker) {
+    int node = numa_worker_node(t, worker);
+    int count = t->first[node + 1] - t->first[node];
+    return t->cpu[t->first[node] + (worker / t->nodes) % count];
+}
+
+void pin_thread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+size_t big_length(size_t bytes) {
+    return (bytes + BIG_CHUNK - 1) & ~(BIG_CHUNK - 1);
+}
+
+/* Returns NULL if the mapping fails (e.g. no hugetlbfs pages). */
+void *big_alloc(size_t bytes, PageKind kind) {
+    size_t len = big_length(bytes);
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    if (kind == PAGES_HUGETLB) flags |= MAP_HUGETLB;
+
+    void *p = mmap(NULL, len, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (p == MAP_FAILED) return NULL;
+    if (kind != PAGES_HUGETLB)
+        madvise(p, len, kind == PAGES_THP ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+    return p;
+}
+
+void big_free(void *p, size_t bytes) {
+    if (p) munmap(p, big_length(bytes));
+}
+
+typedef struct {
+    char *dst;
+    const char *src;
+    size_t bytes;
+    size_t chunk, step;   // copies chunks chunk, chunk + step, ...
+    int cpu;
+} FirstTouch;
+
+void *first_touch_main(void *arg) {
+    FirstTouch *f = arg;
+    pin_thread(f->cpu);
+    for (size_t c = f->chunk; c * BIG_CHUNK < f->bytes; c += f->step) {
+        size_t off = c * BIG_CHUNK;
+        size_t len = f->bytes - off < BIG_CHUNK ? f->bytes - off : BIG_CHUNK;
+        memcpy(f->dst + off, f->src + off, len);
+    }
+    return NULL;
+}
+
+/* Runs one pinned first-touch copier per node and waits for them.
+ * A copier that cannot be started runs on the caller instead, pinned
+ * to the same node, and the caller's affinity is restored after. */
+void first_touch(const NumaTopology *t, FirstTouch f[]) {
+    pthread_t tid[MAX_NODES];
+    int started[MAX_NODES], inlined = 0;
+    for (int k = 0; k < t->nodes; k++) {
+        f[k].cpu = t->cpu[t->first[k]];
+        started[k] = pthread_create(&tid[k], NULL, first_touch_main,
+                                    &f[k]) == 0;
+        inlined |= !started[k];
+    }
+
+    cpu_set_t callerCpus;
+    if (inlined)
+        pthread_getaffinity_np(pthread_self(), sizeof(callerCpus),
+                               &callerCpus);
+    for (int k = 0; k < t->nodes; k++)
+        if (!started[k]) first_touch_main(&f[k]);
+    for (int k = 0; k < t->nodes; k++)
+        if (started[k]) pthread_join(tid[k], NULL);
+    if (inlined)
+        pthread_setaffinity_np(pthread_self(), sizeof(callerCpus),
+                               &callerCpus);
+}
+
+/* Fills copy[k] (allocated here) on node k. Returns 0 on failure. */
+int big_replicate(const NumaTopology *t, const void *src, size_t bytes,
+                  PageKind kind, void *copy[]) {
+    FirstTouch f[MAX_NODES];
+    int ok = 1;
+    for (int k = 0; k < t->nodes; k++) {
+        copy[k] = big_alloc(bytes, kind);
+        if (!copy[k]) ok = 0;
+        f[k] = (FirstTouch){ copy[k], src, bytes, 0, 1, 0 };
+    }
+    if (ok) first_touch(t, f);
+    else
+        for (int k = 0; k < t->nodes; k++) big_free(copy[k], bytes);
+    return ok;
+}
+
+/* One copy with its chunks spread round-robin over the nodes. */
+void *big_interleave(const NumaTopology *t, const void *src, size_t bytes,
+                     PageKind kind) {
+    FirstTouch f[MAX_NODES];
+    void *p = big_alloc(bytes, kind);
+    if (!p) return NULL;
+    for (int k = 0; k < t->nodes; k++)
+        f[k] = (FirstTouch){ p, src, bytes, (size_t)k, (size_t)t->nodes, 0 };
+    first_touch(t, f);
+    return p;
+}
+
+/****************************************************************
+ * Work-stealing runtime
+ * Shared engine for the parallel modes (VR, ANNEAL, DEFECT).
+ * ws_parallel_for runs body over [0, n) on the worker threads
+ * (DISK_SCHED_THREADS, default one per online CPU; the calling
+ * thread is worker 0). Each worker owns a Chase-Lev deque of
+ * index ranges (the C11 formulation of Le et al., PPoPP 2013):
+ *   - a worker splits its range in half until it is at most
+ *     `grain` long, pushing the upper halves to the bottom of
+ *     its deque, runs the rest, then pops from the bottom
+ *   - an idle worker steals from the top of a random victim's
+ *     deque, which holds the largest ranges left
+ * so expensive and cheap iterations balance without static
+ * partitioning. body gets the worker index, so callers can
+ * accumulate into per-worker slots and merge after the call.
+ * With DISK_SCHED_PIN=1 (or a topology passed to
+ * ws_parallel_for_on) worker i is pinned to numa_worker_cpu,
+ * so it stays on node numa_worker_node(i).
+ ****************************************************************/
+#define WS_DEQUE_SLOTS 1024   // power of two
+#define WS_MAX_WORKERS 256
+
+typedef void (*RangeBody)(void *ctx, long lo, long hi, int worker);
+
+typedef struct {
+    atomic_long lo, hi;
+} WsSlot;
+
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_long top;
+    _Alignas(CACHE_LINE) atomic_long bottom;
+    _Alignas(CACHE_LINE) WsSlot buf[WS_DEQUE_SLOTS];
+} WsDeque;
+
+typedef struct {
+    WsDeque *deques;
+    int workers;
+    long grain;
+    RangeBody body;
+    void *ctx;
+    const NumaTopology *pin;   // NULL: let the OS place workers
+    atomic_long remaining;     // iterations not yet run
+} WsPool;
+
+typedef struct {
+    WsPool *pool;
+    int id;
+} WsWorker;
+
+/* Owner only. Returns 0 if the deque is full. */
+int ws_push(WsDeque *d, long lo, long hi) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    if (b - t >= WS_DEQUE_SLOTS) return 0;
+
+    WsSlot *s = &d->buf[b & (WS_DEQUE_SLOTS - 1)];
+    atomic_store_explicit(&s->lo, lo, memory_order_relaxed);
+    atomic_store_explicit(&s->hi, hi, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return 1;
+}
+
+/* Owner only: pops the newest range. Returns 0 if empty. */
+int ws_take(WsDeque *d, long *lo, long *hi) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+    if (t > b) {
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return 0;
+    }
+
+    WsSlot *s = &d->buf[b & (WS_DEQUE_SLOTS - 1)];
+    *lo = atomic_load_explicit(&s->lo, memory_order_relaxed);
+    *hi = atomic_load_explicit(&s->hi, memory_order_relaxed);
+    if (t == b) {   // last one: race the thieves for it
+        int won = atomic_compare_exchange_strong_explicit(
+            &d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return won;
+    }
+    return 1;
+}
+
+/* Any thread: takes the oldest range. Returns 0 if empty or lost. */
+int ws_steal(WsDeque *d, long *lo, long *hi) {
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+    if (t >= b) return 0;
+
+    WsSlot *s = &d->buf[t & (WS_DEQUE_SLOTS - 1)];
+    *lo = atomic_load_explicit(&s->lo, memory_order_relaxed);
+    *hi = atomic_load_explicit(&s->hi, memory_order_relaxed);
+    return atomic_compare_exchange_strong_explicit(
+        &d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+}
+
+void ws_run_range(WsPool *p, int id, long lo, long hi) {
+    while (hi - lo > p->grain) {
+        long mid = lo + (hi - lo) / 2;
+        if (!ws_push(&p->deques[id], mid, hi)) break;   // full: run it all
+        hi = mid;
+    }
+    p->body(p->ctx, lo, hi, id);
+    atomic_fetch_sub_explicit(&p->remaining, hi - lo, memory_order_acq_rel);
+}
+
+void *ws_worker_main(void *arg) {
+    WsWorker *w = arg;
+    WsPool *p = w->pool;
+    unsigned long long rng = 0x57EA1ULL + w->id;
+    long lo, hi;
+    if (p->pin) pin_thread(numa_worker_cpu(p->pin, w->id));
+
+    while (atomic_load_explicit(&p->remaining, memory_order_acquire) > 0) {
+        if (ws_take(&p->deques[w->id], &lo, &hi)) {
+            ws_run_range(p, w->id, lo, hi);
+            continue;
+        }
+        int victim = (int)(rng_next(&rng) % (unsigned long long)p->workers);
+        if (victim != w->id && ws_steal(&p->deques[victim], &lo, &hi))
+            ws_run_range(p, w->id, lo, hi);
+        else
+            sched_yield();
+    }
+    return NULL;
+}
+
+int ws_workers(void) {
+    const char *env = getenv("DISK_SCHED_THREADS");
+    long n = env ? atol(env) : sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) n = 1;
+    return n > WS_MAX_WORKERS ? WS_MAX_WORKERS : (int)n;
+}
+
+/* As ws_parallel_for, pinning workers to pin's nodes unless NULL. */
+void ws_parallel_for_on(long n, long grain, RangeBody body, void *ctx,
+                        const NumaTopology *pin) {
+    if (n <= 0) return;
+    WsPool p;
+    p.workers = ws_workers();
+    p.grain = grain < 1 ? 1 : grain;
+    p.body = body;
+    p.ctx = ctx;
+    p.pin = pin;
+    atomic_init(&p.remaining, n);
+
+    p.deques = cache_alloc(p.workers * sizeof(WsDeque));
+    if (!p.deques) {   // no deques: the caller runs it all as worker 0
+        body(ctx, 0, n, 0);
+        return;
+    }
+    cpu_set_t callerCpus;   // worker 0 is the caller: restore it after
+    pthread_getaffinity_np(pthread_self(), sizeof(callerCpus), &callerCpus);
+    for (int i = 0; i < p.workers; i++) {
+        atomic_init(&p.deques[i].top, 0);
+        atomic_init(&p.deques[i].bottom, 0);
+    }
+
+    WsWorker w[WS_MAX_WORKERS];
+    pthread_t tid[WS_MAX_WORKERS];
+    for (int i = 0; i < p.workers; i++) {
+        w[i].pool = &p;
+        w[i].id = i;
+    }
+    ws_push(&p.deques[0], 0, n);
+    // Workers that fail to start just leave empty deques to steal
+    // from; worker 0 runs until everything is done either way.
+    int started = 1;
+    while (started < p.workers
+           && pthread_create(&tid[started], NULL, ws_worker_main,
+                             &w[started]) == 0)
+        started++;
+    ws_worker_main(&w[0]);
+    for (int i = 1; i < started; i++)
+        pthread_join(tid[i], NULL);
+    free(p.deques);
+    if (pin)
+        pthread_setaffinity_np(pthread_self(), sizeof(callerCpus),
+                               &callerCpus);
+}
+
+/* Runs body over [0, n) in ranges of at most grain iterations. */
+void ws_parallel_for(long n, long grain, RangeBody body, void *ctx) {
+    const char *env = getenv("DISK_SCHED_PIN");
+    if (!env || atoi(env) == 0) {
+        ws_parallel_for_on(n, grain, body, ctx, NULL);
+        return;
+    }
+    NumaTopology t;
+    numa_discover(&t);
+    ws_parallel_for_on(n, grain, body, ctx, &t);
+}
+
+/****************************************************************
+ * simulate
+ * Runs the workload to completion under hs.alg. bg may be NULL.
+ * Background requests go through the same scheduler as
+ * foreground ones; only foreground latency is recorded.
+ ****************************************************************/
+void simulate(Workload *w, HeadState hs, const DiskModel *m,
+              Background *bg, SimStats *st) {
+    OnlineSched s;
+    double now = 0;
+    sched_init(&s, hs);
+    memset(st, 0, sizeof(*st));
+
+    for (;;) {
+        while (w->next_time(w) <= now)
+            sched_push(&s, w->take(w));
+
+        if (sched_len(&s) == 0) {
+            double t = w->next_time(w);
+            if (t == INFINITY) break;
+            if (bg && bg->kind != BG_NONE && bg->every == 0)
+                sched_push(&s, background_next(bg, now));  // idle slot
+            else {
+                now = t;
+                continue;
+            }
+        }
+
+        int travel = 0;
+        int surface = s.hs.surface;
+        IoRequest r = sched_next(&s, now, &travel);
+
+        now += access_time(m, travel, surface_switch(surface, r.surface), &r);
+        st->movement += travel;
+        sched_complete(&s, &r, now);
+
+        if (r.flags & REQ_BACKGROUND) {
+            st->background++;
+            st->bgMovement += travel;
+            if ((r.flags & REQ_MIGRATE) && w->complete)
+                w->complete(w, &r, now);
+        } else {
+            stats_add(st, now - r.arrival);
+            if (w->complete) w->complete(w, &r, now);
+
+            if (bg && bg->kind != BG_NONE && bg->every > 0
+                && ++bg->sinceLast == bg->every) {
+                bg->sinceLast = 0;
+                sched_push(&s, background_next(bg, now));
+            }
+        }
+    }
+
+    st->end = now;
+    sched_free(&s);
+}
+
+/****************************************************************
+ * SsdCache
+ * Write-back SSD tier in front of the HDD, in TIER_BLOCK units:
+ *   - index: AddrMap from block to slot + 1 (0 once evicted)
+ *   - LRU:   doubly linked list over the slots, head = newest
+ *   - admission: writes always allocate; a read miss is
+ *           admitted only on its second miss (counts kept in a
+ *           second AddrMap, the ghost)
+ *   - destage: blocks are queued in the order they became dirty
+ *           and written back as REQ_MIGRATE background writes
+ *           when dirty blocks pass TIER_DIRTY_HIGH of the cache
+ *           or the HDD is idle, at most TIER_DESTAGE_DEPTH at a
+ *           time; evicting a dirty block forces its destage
+ * A request is cached as its first block.
+ ****************************************************************/
+#define TIER_BLOCK         4096LL
+#define SSD_READ_MS        0.1
+#define SSD_WRITE_MS       0.03
+#define TIER_DIRTY_HIGH    0.5
+#define TIER_DESTAGE_DEPTH 4
+
+typedef struct {
+    long long cap, used;
+    unsigned long long *key;
+    int *prev, *next;
+    char *dirty, *destaging;
+    double *dirtyAt;
+    int head, tail;             // LRU ends, -1 when empty
+    AddrMap index, ghost;
+    unsigned long long *fifo;   // dirty order, may hold stale keys
+    long long fifoHead, fifoLen, fifoCap;
+    long long dirtyCount;
+    int outstanding;
+    long long reads, hits, destages;
+} SsdCache;
+
+void ssd_init(SsdCache *c, long long blocks) {
+    memset(c, 0, sizeof(*c));
+    c->cap = blocks;
+    c->key = malloc(blocks * sizeof(*c->key));
+    c->prev = malloc(blocks * sizeof(int));
+    c->next = malloc(blocks * sizeof(int));
+    c->dirty = calloc(blocks, 1);
+    c->destaging = calloc(blocks, 1);
+    c->dirtyAt = calloc(blocks, sizeof(double));
+    c->head = c->tail = -1;
+}
+
+void ssd_free(SsdCache *c) {
+    free(c->key); free(c->prev); free(c->next);
+    free(c->dirty); free(c->destaging); free(c->dirtyAt);
+    free(c->fifo);
+    addrmap_free(&c->index);
+    addrmap_free(&c->ghost);
+}
+
+/* Slot holding key, or -1. */
+int ssd_lookup(const SsdCache *c, unsigned long long key) {
+    long long v = addrmap_get(&c->index, key);
+    return v > 0 ? (int)(v - 1) : -1;
+}
+
+void lru_unlink(SsdCache *c, int s) {
+    if (c->prev[s] >= 0) c->next[c->prev[s]] = c->next[s];
+    else c->head = c->next[s];
+    if (c->next[s] >= 0) c->prev[c->next[s]] = c->prev[s];
+    else c->tail = c->prev[s];
+}
+
+void lru_push_front(SsdCache *c, int s) {
+    c->prev[s] = -1;
+    c->next[s] = c->head;
+    if (c->head >= 0) c->prev[c->head] = s;
+    c->head = s;
+    if (c->tail < 0) c->tail = s;
+}
+
+void ssd_touch(SsdCache *c, int s) {
+    lru_unlink(c, s);
+    lru_push_front(c, s);
+}
+
+int tier_cyl(unsigned long long key) {
+    return (int)((long long)key * TIER_BLOCK / FIO_BYTES_PER_CYL);
+}
+
+IoRequest destage_request(unsigned long long key, double now) {
+    IoRequest r;
+    memset(&r, 0, sizeof(r));
+    r.cyl = tier_cyl(key);
+    r.flags = REQ_BACKGROUND | REQ_MIGRATE | REQ_WRITE;
+    r.dep = -1;
+    r.sectors = (int)(TIER_BLOCK / 512);
+    r.arrival = now;
+    r.lba = (long long)key * (TIER_BLOCK / 512);
+    return r;
+}
+
+/*
+ * Allocates a slot for key, evicting the LRU block if full; a
+ * dirty victim is pushed to the HDD queue as a forced destage.
+ */
+int ssd_insert(SsdCache *c, unsigned long long key, OnlineSched *hdd,
+               double now) {
+    int s;
+    if (c->used < c->cap) {
+        s = (int)c->used++;
+    } else {
+        s = c->tail;
+        lru_unlink(c, s);
+        *addrmap_ref(&c->index, c->key[s]) = 0;
+        if (c->dirty[s]) {
+            c->dirtyCount--;
+            if (!c->destaging[s]) {
+                sched_push(hdd, destage_request(c->key[s], now));
+                c->outstanding++;
+                c->destages++;
+            }
+        }
+    }
+
+    c->key[s] = key;
+    c->dirty[s] = c->destaging[s] = 0;
+    *addrmap_ref(&c->index, key) = (unsigned int)s + 1;
+    lru_push_front(c, s);
+    return s;
+}
+
+void ssd_mark_dirty(SsdCache *c, int s, double now) {
+    c->dirtyAt[s] = now;
+    if (c->dirty[s]) return;
+    c->dirty[s] = 1;
+    c->dirtyCount++;
+
+    if (c->fifoHead + c->fifoLen == c->fifoCap) {
+        if (c->fifoHead > c->fifoCap / 2) {
+            memmove(c->fifo, c->fifo + c->fifoHead,
+                    c->fifoLen * sizeof(*c->fifo));
+            c->fifoHead = 0;
+        } else {
+            c->fifoCap = c->fifoCap ? 2 * c->fifoCap : 256;
+            c->fifo = realloc(c->fifo, c->fifoCap * sizeof(*c->fifo));
+        }
+    }
+    c->fifo[c->fifoHead + c->fifoLen++] = c->key[s];
+}
+
+/* Queues destage writes while the watermark or an idle HDD allows. */
+void ssd_destage(SsdCache *c, OnlineSched *hdd, int hddIdle, double now) {
+    while (c->outstanding < TIER_DESTAGE_DEPTH && c->fifoLen > 0
+           && (c->dirtyCount > TIER_DIRTY_HIGH * c->cap || hddIdle)) {
+        unsigned long long key = c->fifo[c->fifoHead++];
+        c->fifoLen--;
+        int s = ssd_lookup(c, key);
+        if (s < 0 || !c->dirty[s] || c->destaging[s]) continue;
+
+        c->destaging[s] = 1;
+        c->outstanding++;
+        c->destages++;
+        sched_push(hdd, destage_request(key, now));
+        hddIdle = 0;
+    }
+}
+
+/* A destage write finished: the block is clean unless rewritten. */
+void ssd_destaged(SsdCache *c, const IoRequest *r) {
+    c->outstanding--;
+    int s = ssd_lookup(c, (unsigned long long)(r->lba / (TIER_BLOCK / 512)));
+    if (s < 0 || !c->destaging[s]) return;
+
+    c->destaging[s] = 0;
+    c->dirty[s] = 0;
+    c->dirtyCount--;
+    if (c->dirtyAt[s] > r->arrival)
+        ssd_mark_dirty(c, s, c->dirtyAt[s]);   // rewritten meanwhile
+}
+
+/****************************************************************
+ * simulate_tiered
+ * Event loop for the SSD + HDD pair: reads that hit and all
+ * writes complete on the SSD after a fixed latency; read misses
+ * and destages share the HDD, which serves one request at a time
+ * under hs.alg. Latency is end to end for every request;
+ * st->bgMovement is the head movement spent on destaging.
+ ****************************************************************/
+void simulate_tiered(Workload *w, HeadState hs, const DiskModel *m,
+                     SsdCache *c, SimStats *st) {
+    OnlineSched hdd;
+    sched_init(&hdd, hs);
+    memset(st, 0, sizeof(*st));
+
+    EventHeap ssd;                    // SSD completions, id into done[]
+    memset(&ssd, 0, sizeof(ssd));
+    IoRequest *done = NULL;
+    int *freeIds = NULL, nFree = 0, nDone = 0;
+
+    double now = 0, busyUntil = INFINITY;
+    IoRequest cur;
+    memset(&cur, 0, sizeof(cur));
+
+    for (;;) {
+        double tIn = w->next_time(w);
+        double tSsd = ssd.n ? ssd.e[0].t : INFINITY;
+        double t = fmin(tIn, fmin(tSsd, busyUntil));
+        if (t == INFINITY) break;
+        now = t;
+
+        if (busyUntil == t) {
+            busyUntil = INFINITY;
+            sched_complete(&hdd, &cur, now);
+            if (cur.flags & REQ_BACKGROUND) {
+                st->background++;
+                ssd_destaged(c, &cur);
+            } else {
+                stats_add(st, now - cur.arrival);
+                unsigned long long key =
+                    (unsigned long long)(cur.lba / (TIER_BLOCK / 512));
+                if (addrmap_get(&c->ghost, key) >= 2
+                    && ssd_lookup(c, key) < 0)
+                    ssd_insert(c, key, &hdd, now);
+                if (w->complete) w->complete(w, &cur, now);
+            }
+        } else if (tSsd == t) {
+            Event ev = heap_pop(&ssd);
+            stats_add(st, now - done[ev.id].arrival);
+            if (w->complete) w->complete(w, &done[ev.id], now);
+            freeIds[nFree++] = ev.id;
+        } else {
+            IoRequest r = w->take(w);
+            unsigned long long key =
+                (unsigned long long)(r.lba / (TIER_BLOCK / 512));
+            int s = ssd_lookup(c, key);
+            int write = (r.flags & REQ_WRITE) != 0;
+
+            if (!write) c->reads++;
+            if (!write && s < 0) {
+                addrmap_add(&c->ghost, key, 1);
+                sched_push(&hdd, r);
+            } else {
+                if (write) {
+                    if (s < 0) s = ssd_insert(c, key, &hdd, now);
+                    ssd_mark_dirty(c, s, now);
+                } else {
+                    c->hits++;
+                }
+                ssd_touch(c, s);
+
+                int id;
+                if (nFree) {
+                    id = freeIds[--nFree];
+                } else {
+                    id = nDone++;
+                    done = realloc(done, nDone * sizeof(IoRequest));
+                    freeIds = realloc(freeIds, nDone * sizeof(int));
+                }
+                done[id] = r;
+                heap_push(&ssd, now + (write ? SSD_WRITE_MS : SSD_READ_MS),
+                          id);
+            }
+        }
+
+        int idle = busyUntil == INFINITY;
+        ssd_destage(c, &hdd, idle && sched_len(&hdd) == 0, now);
+        if (idle && sched_len(&hdd) > 0) {
+            int travel = 0;
+            int surface = hdd.hs.surface;
+            cur = sched_next(&hdd, now, &travel);
+            busyUntil = now + access_time(m, travel,
+                                          surface_switch(surface, cur.surface),
+                                          &cur);
+            st->movement += travel;
+            if (cur.flags & REQ_BACKGROUND) st->bgMovement += travel;
+        }
+    }
+
+    st->end = now;
+    sched_free(&hdd);
+    free(done);
+    free(freeIds);
+    free(ssd.e);
+}
+
+/****************************************************************
+ * print_result
+ * Prints sequence and total movement in the required format.
+ ****************************************************************/
+void print_result(const char *name, Result r) {
+    printf("%s DISK SCHEDULING ALGORITHM:\n\n", name);
+
+    for (int i = 0; i < r.len; i++) {
+        printf("%d", r.seq[i]);
+        if (i < r.len - 1) printf(", ");
+    }
+
+    printf("\n\n%s - Total head movements = %d\n\n",
+           name, r.movement);
+}
+
+/****************************************************************
+ * run_window
+ * WINDOW mode: reports totals for the request window [i, j) as
+ * if only those requests were queued, with the head at start.
+ ****************************************************************/
+int run_window(int argc, char *argv[], int req[], int start,
+               Direction dir) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: WINDOW <i> <j>\n");
+        return 1;
+    }
+
+    int i = atoi(argv[0]);
+    int j = atoi(argv[1]);
+    if (i < 0 || j > NUM_REQUESTS || i >= j) {
+        fprintf(stderr, "ERROR: Window must satisfy 0 <= i < j <= %d.\n",
+                NUM_REQUESTS);
+        return 1;
+    }
+
+    static TraceIndex ti;
+    build_trace_index(req, &ti);
+
+    CylSet cyls = window_cylinders(&ti, i, j);
+    WindowShape w = cylset_shape(&cyls, start);
+
+    printf("Window = [%d, %d)\n\n", i, j);
+    printf("FCFS - Total head movements = %lld\n",
+           fcfs_window_movement(req, ti.prefix, i, j, start));
+    for (int a = ALG_SCAN; a <= ALG_CLOOK; a++)
+        printf("%s - Total head movements = %d\n", ALG_NAMES[a],
+               shape_movement(w, (Algorithm)a, start, dir));
+    return 0;
+}
+
+/****************************************************************
+ * run_slide
+ * SLIDE mode: "what if the queue held the last W requests".
+ * The window is kept in a CylTree and advanced one request at a
+ * time (one insert, one delete), so sweep totals come straight
+ * from order statistics and SSTF runs in O(W log C) per window
+ * instead of re-sorting and rescanning.
+ ****************************************************************/
+int run_slide(int argc, char *argv[], int req[], int start,
+              Direction dir) {
+    if (argc != 1) {
+        fprintf(stderr, "Usage: SLIDE <W>\n");
+        return 1;
+    }
+
+    int W = atoi(argv[0]);
+    if (W < 1 || W > NUM_REQUESTS) {
+        fprintf(stderr, "ERROR: Window size must be between 1 and %d.\n",
+                NUM_REQUESTS);
+        return 1;
+    }
+
+    long long prefix[NUM_REQUESTS];
+    build_prefix(req, NUM_REQUESTS, prefix);
+
+    // nextSame[i]: next arrival on the same cylinder as req[i]
+    int nextSame[NUM_REQUESTS];
+    int last[NUM_CYLINDERS];
+    for (int c = 0; c < NUM_CYLINDERS; c++) last[c] = NUM_REQUESTS;
+    for (int i = NUM_REQUESTS - 1; i >= 0; i--) {
+        nextSame[i] = last[req[i]];
+        last[req[i]] = i;
+    }
+
+    // first[c]: earliest arrival still in the window on cylinder c
+    int first[NUM_CYLINDERS];
+    static CylTree t;
+    memset(&t, 0, sizeof(t));
+
+    printf("Window size = %d\n\n", W);
+    printf("%-10s", "Window");
+    for (int a = 0; a < NUM_ALGS; a++)
+        printf("%8s", ALG_NAMES[a]);
+    printf("\n");
+
+    for (int j = 0; j < NUM_REQUESTS; j++) {
+        if (cyltree_rank(&t, req[j] + 1) == cyltree_rank(&t, req[j]))
+            first[req[j]] = j;
+        cyltree_add(&t, req[j], 1);
+
+        int i = j + 1 - W;
+        if (i < 0) continue;
+
+        WindowShape w = cyltree_shape(&t, start);
+        char label[32];
+        snprintf(label, sizeof(label), "[%d, %d)", i, j + 1);
+
+        printf("%-10s%8lld%8d", label,
+               fcfs_window_movement(req, prefix, i, j + 1, start),
+               cyltree_sstf(&t, first, start));
+        for (int a = ALG_SCAN; a <= ALG_CLOOK; a++)
+            printf("%8d", shape_movement(w, (Algorithm)a, start, dir));
+        printf("\n");
+
+        cyltree_add(&t, req[i], -1);
+        first[req[i]] = nextSame[i];
+    }
+    return 0;
+}
+
+/****************************************************************
+ * run_continuum
+ * VR mode: sweeps R over [0, 1] in `steps` increments (on the
+ * work-stealing runtime) and prints the movement vs max-wait
+ * frontier, marking Pareto-optimal points with '*'. Grouped SSTF
+ * is reported for a range of group sizes.
+ ****************************************************************/
+#define MAX_VR_STEPS 1000
+#define VR_GRAIN     4
+
+typedef struct {
+    const SortedReq *s;
+    int *req;
+    int start;
+    Direction dir;
+    int steps;
+    OrderStats *vr;
+} VrSweep;
+
+void vr_body(void *ctx, long lo, long hi, int worker) {
+    VrSweep *v = ctx;
+    (void)worker;
+    for (long i = lo; i < hi; i++) {
+        int order[NUM_REQUESTS];
+        schedule_vr(v->s, NUM_REQUESTS, v->start, v->dir,
+                    (double)i / v->steps, order);
+        v->vr[i] = order_stats(v->req, order, NUM_REQUESTS, v->start);
+    }
+}
+
+int run_continuum(int argc, char *argv[], int req[], int start,
+                  Direction dir) {
+    int steps = argc > 0 ? atoi(argv[0]) : 10;
+    if (argc > 1 || steps < 1 || steps > MAX_VR_STEPS) {
+        fprintf(stderr, "Usage: VR [steps 1..%d]\n", MAX_VR_STEPS);
+        return 1;
+    }
+
+    SortedReq s[NUM_REQUESTS];
+    sort_requests(req, NUM_REQUESTS, s);
+
+    static OrderStats vr[MAX_VR_STEPS + 1];
+    VrSweep sweep = { s, req, start, dir, steps, vr };
+    ws_parallel_for(steps + 1, VR_GRAIN, vr_body, &sweep);
+
+    printf("V(R) frontier:\n\n");
+    printf("%8s%10s%10s\n", "R", "Movement", "MaxWait");
+    for (int i = 0; i <= steps; i++) {
+        int dominated = 0;
+        for (int j = 0; j <= steps && !dominated; j++)
+            dominated = vr[j].movement <= vr[i].movement
+                     && vr[j].max_wait <= vr[i].max_wait
+                     && (vr[j].movement < vr[i].movement
+                         || vr[j].max_wait < vr[i].max_wait);
+        printf("%8.3f%10d%10d%s\n", (double)i / steps,
+               vr[i].movement, vr[i].max_wait, dominated ? "" : " *");
+    }
+
+    static const int groups[] = { 1, 10, 25, 50, 100, NUM_CYLINDERS };
+    printf("\nGrouped SSTF:\n\n");
+    printf("%8s%10s%10s\n", "Group", "Movement", "MaxWait");
+    for (size_t g = 0; g < sizeof(groups) / sizeof(groups[0]); g++) {
+        int order[NUM_REQUESTS];
+        schedule_grouped_sstf(s, NUM_REQUESTS, start, dir, groups[g], order);
+        OrderStats st = order_stats(req, order, NUM_REQUESTS, start);
+        printf("%8d%10d%10d\n", groups[g], st.movement, st.max_wait);
+    }
+    return 0;
+}
+
+/****************************************************************
+ * run_beam
+ * BEAM mode: look-ahead depth k, beam width b. Reports beam
+ * search movement next to SSTF and the offline optimum, and how
+ * much of the SSTF-to-optimal gap the look-ahead recovers. Also
+ * checks that no depth from 1 to NUM_REQUESTS at width b does
+ * worse than SSTF, failing the mode if one does.
+ ****************************************************************/
+int run_beam(int argc, char *argv[], int req[], int start) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: BEAM <k> <b>\n");
+        return 1;
+    }
+
+    int k = atoi(argv[0]);
+    int b = atoi(argv[1]);
+    if (k < 1 || k > NUM_REQUESTS || b < 1 || b > MAX_BEAM) {
+        fprintf(stderr, "ERROR: Need 1 <= k <= %d and 1 <= b <= %d.\n",
+                NUM_REQUESTS, MAX_BEAM);
+        return 1;
+    }
+
+    static BeamPool pool;
+    Result sstf = schedule_sstf(req, start);
+    Result beam = schedule_beam(req, start, k, b, &pool);
+    int opt = optimal_movement(req, NUM_REQUESTS, start);
+
+    char name[64];
+    snprintf(name, sizeof(name), "BEAM (k=%d, b=%d)", k, b);
+    print_result(name, beam);
+
+    printf("SSTF    - Total head movements = %d\n", sstf.movement);
+    printf("BEAM    - Total head movements = %d\n", beam.movement);
+    printf("OPTIMAL - Total head movements = %d\n", opt);
+    if (sstf.movement > opt)
+        printf("Gap recovered = %.1f%%\n",
+               100.0 * (sstf.movement - beam.movement)
+                     / (sstf.movement - opt));
+    printf("Nodes expanded = %lld\n", pool.expanded);
+
+    for (int d = 1; d <= NUM_REQUESTS; d++) {
+        Result check = schedule_beam(req, start, d, b, &pool);
+        if (check.movement > sstf.movement) {
+            fprintf(stderr, "ERROR: BEAM (k=%d, b=%d) moves %d, worse "
+                            "than SSTF's %d.\n", d, b, check.movement,
+                    sstf.movement);
+            return 1;
+        }
+    }
+    printf("No worse than SSTF for k = 1..%d\n", NUM_REQUESTS);
+    return 0;
+}
+
+/****************************************************************
+ * run_anneal
+ * ANNEAL mode: optimizes movement + weight * lateness with
+ * `restarts` independent annealing runs (on the work-stealing
+ * runtime, each worker keeping its own best, merged after),
+ * seeded round-robin from LOOK in both directions and SSTF, and
+ * reports the seeds next to the best result. Ties go to the
+ * lowest restart, so the result does not depend on the workers.
+ ****************************************************************/
+#define MAX_RESTARTS 4096
+
+typedef struct {
+    _Alignas(CACHE_LINE) Schedule best;
+    int idx;   // restart that produced best, -1 if none yet
+} AnnealBest;
+
+typedef struct {
+    int *req;
+    int start;
+    Objective obj;
+    const Schedule *seeds;
+    int nseeds;
+    AnnealBest *best;   // one per worker
+} AnnealRuns;
+
+void anneal_keep(AnnealBest *b, const Schedule *s, int idx) {
+    if (b->idx < 0 || s->cost < b->best.cost
+        || (s->cost == b->best.cost && idx < b->idx)) {
+        b->best = *s;
+        b->idx = idx;
+    }
+}
+
+void anneal_body(void *ctx, long lo, long hi, int worker) {
+    AnnealRuns *a = ctx;
+    for (long i = lo; i < hi; i++) {
+        Schedule run = a->seeds[i % a->nseeds];
+        anneal_schedule(a->req, a->start, a->obj, 0x5EEDULL + i, &run);
+        anneal_keep(&a->best[worker], &run, (int)i);
+    }
+}
+
+int run_anneal(int argc, char *argv[], int req[], int start) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: ANNEAL <weight> <slack> [restarts]\n");
+        return 1;
+    }
+
+    Objective obj = { atof(argv[0]), atoi(argv[1]) };
+    int restarts = argc > 2 ? atoi(argv[2]) : 16;
+    if (obj.weight < 0 || restarts < 1 || restarts > MAX_RESTARTS) {
+        fprintf(stderr, "ERROR: Need weight >= 0 and 1..%d restarts.\n",
+                MAX_RESTARTS);
+        return 1;
+    }
+
+    SortedReq s[NUM_REQUESTS];
+    sort_requests(req, NUM_REQUESTS, s);
+
+    enum { SEED_LOOK_LEFT, SEED_LOOK_RIGHT, SEED_SSTF, NUM_SEEDS };
+    const char *seedNames[NUM_SEEDS] = { "LOOK LEFT", "LOOK RIGHT", "SSTF" };
+    Schedule seeds[NUM_SEEDS];
+    schedule_vr(s, NUM_REQUESTS, start, DIR_LEFT, 1.0,
+                seeds[SEED_LOOK_LEFT].order);
+    schedule_vr(s, NUM_REQUESTS, start, DIR_RIGHT, 1.0,
+                seeds[SEED_LOOK_RIGHT].order);
+    schedule_vr(s, NUM_REQUESTS, start, DIR_LEFT, 0.0,
+                seeds[SEED_SSTF].order);
+    for (int i = 0; i < NUM_SEEDS; i++)
+        evaluate_schedule(req, start, obj, &seeds[i]);
+
+    static AnnealBest perWorker[WS_MAX_WORKERS];
+    for (int w = 0; w < WS_MAX_WORKERS; w++) perWorker[w].idx = -1;
+    AnnealRuns job = { req, start, obj, seeds, NUM_SEEDS, perWorker };
+    ws_parallel_for(restarts, 1, anneal_body, &job);
+
+    AnnealBest merged = { .idx = -1 };
+    for (int w = 0; w < WS_MAX_WORKERS; w++)
+        if (perWorker[w].idx >= 0)
+            anneal_keep(&merged, &perWorker[w].best, perWorker[w].idx);
+    const Schedule *best = &merged.best;
+
+    printf("Objective = movement + %g * lateness (slack %d slots)\n\n",
+           obj.weight, obj.slack);
+    printf("%-12s%10s%10s%12s\n", "Schedule", "Movement", "Lateness",
+           "Objective");
+    for (int i = 0; i < NUM_SEEDS; i++)
+        printf("%-12s%10d%10d%12.1f\n", seedNames[i], seeds[i].movement,
+               seeds[i].lateness, seeds[i].cost);
+    printf("%-12s%10d%10d%12.1f\n", "ANNEALED", best->movement,
+           best->lateness, best->cost);
+    printf("\nMovement lower bound (no deadlines) = %d\n",
+           optimal_movement(req, NUM_REQUESTS, start));
+
+    printf("\nANNEALED order:\n\n");
+    for (int k = 0; k < NUM_REQUESTS; k++)
+        printf("%d%s", req[best->order[k]],
+               k < NUM_REQUESTS - 1 ? ", " : "\n");
+    return 0;
+}
+
+/****************************************************************
+ * run_ordering
+ * ORDER mode: tags the trace with a barrier every B requests, a
+ * FUA write every F requests and a dependency on the previous
+ * request every D requests (0 disables each), then reports every
+ * algorithm's movement with and without the constraints.
+ ****************************************************************/
+int run_ordering(int argc, char *argv[], int req[], int start,
+                 Direction dir) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: ORDER <barrier every> <fua every> "
+                        "<dep every>\n");
+        return 1;
+    }
+
+    int B = atoi(argv[0]), F = atoi(argv[1]), D = atoi(argv[2]);
+    if (B < 0 || F < 0 || D < 0) {
+        fprintf(stderr, "ERROR: Intervals must be >= 0.\n");
+        return 1;
+    }
+
+    IoRequest free_[NUM_REQUESTS], tagged[NUM_REQUESTS];
+    int barriers = 0, fuas = 0, deps = 0;
+    for (int i = 0; i < NUM_REQUESTS; i++) {
+        memset(&free_[i], 0, sizeof(IoRequest));
+        memset(&tagged[i], 0, sizeof(IoRequest));
+        free_[i].cyl = tagged[i].cyl = req[i];
+        free_[i].dep = tagged[i].dep = -1;
+
+        if (B && (i + 1) % B == 0) { tagged[i].flags |= REQ_BARRIER; barriers++; }
+        if (F && (i + 1) % F == 0) { tagged[i].flags |= REQ_FUA; fuas++; }
+        if (D && i > 0 && i % D == 0) { tagged[i].dep = i - 1; deps++; }
+    }
+
+    printf("Barriers = %d, FUA = %d, Dependencies = %d\n\n",
+           barriers, fuas, deps);
+    printf("%-8s%14s%14s%10s\n", "", "Unconstrained", "Constrained",
+           "Cost");
+
+    for (int a = 0; a < NUM_ALGS; a++) {
+        HeadState hs = { (Algorithm)a, start, dir, 0, NULL, 0 };
+        int order[NUM_REQUESTS];
+        int base = dispatch_ordered(free_, NUM_REQUESTS, hs, order);
+        int cons = dispatch_ordered(tagged, NUM_REQUESTS, hs, order);
+
+        printf("%-8s%14d%14d%+9.1f%%\n", ALG_NAMES[a], base, cons,
+               base ? 100.0 * (cons - base) / base : 0.0);
+    }
+    return 0;
+}
+
+/****************************************************************
+ * run_background
+ * BG mode: replays the trace open-loop with and without a scrub
+ * or rebuild stream and reports foreground latency inflation
+ * per algorithm.
+ ****************************************************************/
+int run_background(int argc, char *argv[], int req[], int start,
+                   Direction dir) {
+    if (argc < 2 || argc > 4) {
+        fprintf(stderr, "Usage: BG <SCRUB|REBUILD> <every|0=idle> "
+                        "[gap ms] [passes]\n");
+        return 1;
+    }
+
+    Background bg = { BG_NONE, atoi(argv[1]), 0, 0 };
+    if (strcmp(argv[0], "SCRUB") == 0) bg.kind = BG_SCRUB;
+    else if (strcmp(argv[0], "REBUILD") == 0) bg.kind = BG_REBUILD;
+
+    double gap = argc > 2 ? atof(argv[2]) : SIM_GAP;
+    int passes = argc > 3 ? atoi(argv[3]) : SIM_PASSES;
+    if (bg.kind == BG_NONE || bg.every < 0 || gap <= 0 || passes < 1) {
+        fprintf(stderr, "ERROR: Invalid background configuration.\n");
+        return 1;
+    }
+
+    DiskModel m = { SIM_SEEK_PER_CYL, SIM_SERVICE, 0, 0 };
+
+    printf("Background = %s, %s, gap = %.2f ms, passes = %d\n\n",
+           argv[0], bg.every ? "rate-limited" : "idle slots", gap, passes);
+    printf("%-8s%10s%10s%10s%10s%10s%8s\n", "", "Mean", "P95",
+           "Mean w/BG", "P95 w/BG", "Inflate", "BG I/O");
+
+    for (int a = 0; a < NUM_ONLINE_ALGS; a++) {
+        HeadState hs = { (Algorithm)a, start, dir, 0, NULL, 0 };
+        TraceReplay tr;
+        SimStats base, mixed;
+
+        Workload w = trace_workload(&tr, req, passes, gap);
+        simulate(&w, hs, &m, NULL, &base);
+
+        Background b = bg;
+        w = trace_workload(&tr, req, passes, gap);
+        simulate(&w, hs, &m, &b, &mixed);
+
+        double m0 = stats_mean(&base), m1 = stats_mean(&mixed);
+        printf("%-8s%10.2f%10.2f%10.2f%10.2f%+9.1f%%%8d\n", ALG_NAMES[a],
+               m0, stats_percentile(&base, 95), m1,
+               stats_percentile(&mixed, 95),
+               m0 > 0 ? 100.0 * (m1 - m0) / m0 : 0.0, mixed.background);
+
+        free(base.lat);
+        free(mixed.lat);
+    }
+    return 0;
+}
+
+/****************************************************************
+ * run_closed
+ * CLOSED mode: closed-loop clients, doubling N from 1 up to the
+ * given maximum, reporting throughput and latency vs N for each
+ * algorithm.
+ ****************************************************************/
+#define CLOSED_THINK 10.0   // default mean think time (ms)
+#define CLOSED_EACH  20     // default requests per client
+
+int run_closed(int argc, char *argv[], int req[], int start,
+               Direction dir) {
+    if (argc < 1 || argc > 3) {
+        fprintf(stderr, "Usage: CLOSED <max clients> [think ms] "
+                        "[requests per client]\n");
+        return 1;
+    }
+
+    int maxN = atoi(argv[0]);
+    double think = argc > 1 ? atof(argv[1]) : CLOSED_THINK;
+    int each = argc > 2 ? atoi(argv[2]) : CLOSED_EACH;
+    if (maxN < 1 || think < 0 || each < 1) {
+        fprintf(stderr, "ERROR: Invalid closed-loop configuration.\n");
+        return 1;
+    }
+
+    DiskModel m = { SIM_SEEK_PER_CYL, SIM_SERVICE, 0, 0 };
+    printf("Closed loop: think = %.2f ms, %d requests per client\n",
+           think, each);
+
+    for (int a = 0; a < NUM_ONLINE_ALGS; a++) {
+        printf("\n%s:\n%10s%12s%10s%10s\n", ALG_NAMES[a], "Clients",
+               "IOPS", "Mean", "P95");
+
+        for (int n = 1; ; n = n * 2 < maxN ? n * 2 : maxN) {
+            HeadState hs = { (Algorithm)a, start, dir, 0, NULL, 0 };
+            ClosedLoop cl;
+            SimStats st;
+
+            Workload w = closed_workload(&cl, req, n, each, think);
+            simulate(&w, hs, &m, NULL, &st);
+
+            printf("%10d%12.1f%10.2f%10.2f\n", n,
+                   st.end > 0 ? 1000.0 * st.n / st.end : 0.0,
+                   stats_mean(&st), stats_percentile(&st, 95));
+
+            closed_free(&cl);
+            free(st.lat);
+            if (n == maxN) break;
+        }
+    }
+    return 0;
+}
+
+/****************************************************************
+ * run_fio
+ * FIO mode: drives the simulator from a fio job file and reports
+ * throughput and read/write latency per algorithm.
+ ****************************************************************/
+int run_fio(int argc, char *argv[], int start, Direction dir) {
+    if (argc != 1) {
+        fprintf(stderr, "Usage: FIO <job file>\n");
+        return 1;
+    }
+
+    static FioJob jobs[MAX_FIO_JOBS];
+    int n = parse_fio_file(argv[0], jobs, MAX_FIO_JOBS);
+    if (n < 0) return 1;
+    if (n == 0) {
+        fprintf(stderr, "ERROR: No jobs in %s.\n", argv[0]);
+        return 1;
+    }
+
+    printf("fio jobs:\n");
+    for (int i = 0; i < n; i++)
+        printf("  %-16s %s %d%% read, bs=%lld, iodepth=%d, numjobs=%d\n",
+               jobs[i].name, jobs[i].random ? "random" : "sequential",
+               jobs[i].readPct, jobs[i].bs, jobs[i].iodepth,
+               jobs[i].numjobs);
+
+    DiskModel m = { SIM_SEEK_PER_CYL, SIM_SERVICE, 0, 0 };
+    printf("\n%-8s%10s%10s%10s%10s\n", "", "IOPS", "Mean", "P95", "Max");
+
+    for (int a = 0; a < NUM_ONLINE_ALGS; a++) {
+        HeadState hs = { (Algorithm)a, start, dir, 0, NULL, 0 };
+        FioWorkload fw;
+        SimStats st;
+
+        Workload w = fio_workload(&fw, jobs, n);
+        simulate(&w, hs, &m, NULL, &st);
+
+        printf("%-8s%10.1f%10.2f%10.2f%10.2f\n", ALG_NAMES[a],
+               st.end > 0 ? 1000.0 * st.n / st.end : 0.0,
+               stats_mean(&st), stats_percentile(&st, 95),
+               stats_percentile(&st, 100));
+
+        fio_free(&fw);
+        free(st.lat);
+    }
+    return 0;
+}
+
+/****************************************************************
+ * run_blkmq
+ * BLKMQ mode: submission throughput and lock contention of the
+ * legacy single queue vs blk-mq with N hardware queues, for each
+ * scheduler plugged into the scheduler layer.
+ ****************************************************************/
+int run_blkmq(int argc, char *argv[]) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: BLKMQ <cpus> <hw queues> "
+                        "[requests per cpu]\n");
+        return 1;
+    }
+
+    int cpus = atoi(argv[0]);
+    int hwq = atoi(argv[1]);
+    int each = argc > 2 ? atoi(argv[2]) : MQ_REQUESTS;
+    if (cpus < 1 || cpus > MAX_MQ_CPUS || hwq < 1 || hwq > cpus
+        || each < 1) {
+        fprintf(stderr, "ERROR: Need 1 <= hw queues <= cpus <= %d.\n",
+                MAX_MQ_CPUS);
+        return 1;
+    }
+
+    printf("CPUs = %d, hardware queues = %d, %d submissions per CPU\n\n",
+           cpus, hwq, each);
+    printf("%-12s%24s%32s\n", "", "Single queue", "blk-mq");
+    printf("%-12s%10s%14s%10s%12s%10s\n", "Scheduler", "Mops/s",
+           "Wait ns", "Mops/s", "Wait ns", "Contended");
+
+    for (size_t i = 0; i < sizeof(MQ_SCHEDULERS) / sizeof(MQ_SCHEDULERS[0]);
+         i++) {
+        const MqScheduler *sch = &MQ_SCHEDULERS[i];
+        MqResult mq = simulate_submission(sch, cpus, hwq, each);
+
+        if (!sch->legacy) {
+            printf("%-12s%10s%14s", sch->name, "-", "-");
+        } else {
+            MqResult sq = simulate_submission(sch, cpus, 0, each);
+            printf("%-12s%10.2f%14.1f", sch->name, sq.throughput / 1e6,
+                   sq.waitNs);
+        }
+        printf("%10.2f%12.1f%9.1f%%\n", mq.throughput / 1e6, mq.waitNs,
+               100.0 * mq.contended);
+    }
+    return 0;
+}
+
+/****************************************************************
+ * run_zbr
+ * ZBR mode: prints the zone table, then replays the trace with
+ * requests of the given size under the flat and the zoned
+ * service-time models, adding SSTF weighted by modelled access
+ * time (SSTF-W) for comparison.
+ ****************************************************************/
+int run_zbr(int argc, char *argv[], int req[], int start,
+            Direction dir) {
+    if (argc > 3) {
+        fprintf(stderr, "Usage: ZBR [sectors] [gap ms] [passes]\n");
+        return 1;
+    }
+
+    int sectors = argc > 0 ? atoi(argv[0]) : 256;
+    double gap = argc > 1 ? atof(argv[1]) : SIM_GAP;
+    int passes = argc > 2 ? atoi(argv[2]) : SIM_PASSES;
+    if (sectors < 1 || gap <= 0 || passes < 1) {
+        fprintf(stderr, "ERROR: Invalid ZBR configuration.\n");
+        return 1;
+    }
+
+    printf("%-6s%12s%12s%10s\n", "Zone", "Cylinders", "Sect/track",
+           "MB/s");
+    for (int z = 0; z < NUM_ZONES; z++) {
+        int last = z + 1 < NUM_ZONES ? ZBR_ZONES[z + 1].firstCyl - 1
+                                     : NUM_CYLINDERS - 1;
+        char range[32];
+        snprintf(range, sizeof(range), "%d-%d", ZBR_ZONES[z].firstCyl, last);
+        printf("%-6d%12s%12d%10.1f\n", z, range,
+               ZBR_ZONES[z].sectorsPerTrack,
+               ZBR_ZONES[z].sectorsPerTrack * 512.0 / ZBR_REV_MS / 1000);
+    }
+
+    DiskModel flat = { SIM_SEEK_PER_CYL, SIM_SERVICE, 0, 0 };
+    DiskModel zoned = { SIM_SEEK_PER_CYL, SIM_SERVICE, 1, 0 };
+
+    printf("\nRequest size = %d sectors, gap = %.2f ms, passes = %d\n\n",
+           sectors, gap, passes);
+    printf("%-10s%10s%10s%12s%10s%10s\n", "", "Flat Mean", "Flat P95",
+           "Zoned IOPS", "Mean", "P95");
+
+    for (int a = 0; a <= NUM_ONLINE_ALGS; a++) {
+        // the extra last row is SSTF weighted by access time
+        int weighted = a == NUM_ONLINE_ALGS;
+        Algorithm alg = weighted ? ALG_SSTF : (Algorithm)a;
+        // SSTF-W weighs by the model each run is simulated under
+        HeadState hs = { alg, start, dir, 0, weighted ? &flat : NULL, 0 };
+        TraceReplay tr;
+        SimStats f, zs;
+
+        Workload w = trace_workload(&tr, req, passes, gap);
+        tr.sectors = sectors;
+        simulate(&w, hs, &flat, NULL, &f);
+
+        if (weighted) hs.weigh = &zoned;
+        w = trace_workload(&tr, req, passes, gap);
+        tr.sectors = sectors;
+        simulate(&w, hs, &zoned, NULL, &zs);
+
+        printf("%-10s%10.2f%10.2f%12.1f%10.2f%10.2f\n",
+               weighted ? "SSTF-W" : ALG_NAMES[a], stats_mean(&f),
+               stats_percentile(&f, 95), 1000.0 * zs.n / zs.end,
+               stats_mean(&zs), stats_percentile(&zs, 95));
+
+        free(f.lat);
+        free(zs.lat);
+    }
+    return 0;
+}
+
+/****************************************************************
+ * run_place
+ * PLACE mode: counts block accesses, builds an organ-pipe or
+ * frequency-sorted relocation map, remaps the trace through it
+ * and reruns the six schedulers on the original and the placed
+ * layout. With a fio job file the blocks are 4 KiB units of the
+ * jobs' byte streams (up to PLACE_MAX_IOS ios, round-robin over
+ * the job clones), scheduled NUM_REQUESTS at a time; otherwise
+ * each cylinder of request.bin is one block.
+ ****************************************************************/
+#define PLACE_UNIT    4096LL
+#define PLACE_MAX_IOS (1 << 20)
+
+/* Total movement serving cyls[] in batches of NUM_REQUESTS. The
+ * last n % NUM_REQUESTS requests are not a full batch and are left
+ * out (run_place reports how many). */
+long long batch_movement(Algorithm alg, const int cyls[], long long n,
+                         int start, Direction dir) {
+    long long total = 0;
+    for (long long b = 0; b + NUM_REQUESTS <= n; b += NUM_REQUESTS) {
+        int req[NUM_REQUESTS], sorted[NUM_REQUESTS];
+        memcpy(req, cyls + b, sizeof(req));
+        memcpy(sorted, req, sizeof(req));
+        qsort(sorted, NUM_REQUESTS, sizeof(int), cmp_int);
+
+        Result r = run_algorithm(alg, req, sorted, start, dir);
+        total += r.movement;
+        start = r.seq[r.len - 1];
+    }
+    return total;
+}
+
+/* Fills keys[] round-robin from the jobs' streams; returns the count. */
+long long fio_block_trace(const FioJob jobs[], int n,
+                          unsigned long long keys[], long long max) {
+    int count = 0;
+    for (int i = 0; i < n; i++) count += jobs[i].numjobs;
+    FioStream *fs = malloc(count * sizeof(FioStream));
+
+    int id = 0;
+    for (int i = 0; i < n; i++)
+        for (int c = 0; c < jobs[i].numjobs; c++)
+            fio_stream_init(&fs[id++], &jobs[i], c);
+
+    long long len = 0;
+    for (int live = 1; live && len < max; ) {
+        live = 0;
+        for (int s = 0; s < count && len < max; s++) {
+            if (fs[s].left <= 0) continue;
+            fs[s].left--;
+            live = 1;
+            long long byte = fs[s].job->offset
+                           + fio_stream_block(&fs[s]) * fs[s].job->bs;
+            keys[len++] = (unsigned long long)(byte / PLACE_UNIT);
+        }
+    }
+    free(fs);
+    return len;
+}
+
+int run_place(int argc, char *argv[], int req[], int start,
+              Direction dir) {
+    if (argc < 1 || argc > 2) {
+        fprintf(stderr, "Usage: PLACE <ORGAN|FREQ> [fio job file]\n");
+        return 1;
+    }
+
+    PlacementKind kind;
+    if (strcmp(argv[0], "ORGAN") == 0) kind = PLACE_ORGAN;
+    else if (strcmp(argv[0], "FREQ") == 0) kind = PLACE_FREQ;
+    else {
+        fprintf(stderr, "ERROR: Placement must be ORGAN or FREQ.\n");
+        return 1;
+    }
+
+    unsigned long long *keys;
+    long long n, perCyl, unitsPerCyl;
+
+    if (argc == 2) {
+        static FioJob jobs[MAX_FIO_JOBS];
+        int nj = parse_fio_file(argv[1], jobs, MAX_FIO_JOBS);
+        if (nj < 0) return 1;
+        if (nj == 0) {
+            fprintf(stderr, "ERROR: No jobs in %s.\n", argv[1]);
+            return 1;
+        }
+        keys = malloc(PLACE_MAX_IOS * sizeof(*keys));
+        if (!keys) {
+            fprintf(stderr, "ERROR: Cannot allocate %d requests.\n",
+                    PLACE_MAX_IOS);
+            return 1;
+        }
+        n = fio_block_trace(jobs, nj, keys, PLACE_MAX_IOS);
+        perCyl = unitsPerCyl = FIO_BYTES_PER_CYL / PLACE_UNIT;
+    } else {
+        keys = malloc(NUM_REQUESTS * sizeof(*keys));
+        for (int i = 0; i < NUM_REQUESTS; i++)
+            keys[i] = (unsigned long long)req[i];
+        n = NUM_REQUESTS;
+        perCyl = unitsPerCyl = 1;
+    }
+
+    AddrMap m;
+    memset(&m, 0, sizeof(m));
+    int *orig = malloc((n ? n : 1) * sizeof(int));
+    int *placed = malloc((n ? n : 1) * sizeof(int));
+    int ok = orig && placed;
+    for (long long i = 0; ok && i < n; i++) ok = addrmap_add(&m, keys[i], 1);
+    int fit = ok ? place_blocks(&m, kind, perCyl) : -1;
+    if (fit <= 0) {
+        if (fit < 0)
+            fprintf(stderr, "ERROR: Cannot allocate the placement map "
+                            "for %lld requests.\n", n);
+        else
+            fprintf(stderr, "ERROR: Blocks do not fit on the disk.\n");
+        free(keys); free(orig); free(placed);
+        addrmap_free(&m);
+        return 1;
+    }
+    long long distinct = m.len, slots = m.nslots;
+
+    for (long long i = 0; i < n; i++)
+        orig[i] = (int)(keys[i] / unitsPerCyl);
+    for (long long i = 0; i < n; i++)
+        placed[i] = (int)addrmap_get(&m, keys[i]);
+
+    printf("Placement = %s, %lld requests, %lld distinct blocks "
+           "(map: %lld slots, %lld KiB)\n", argv[0], n, distinct, slots,
+           slots * (long long)(sizeof(*m.keys) + sizeof(*m.vals)) / 1024);
+    if (n % NUM_REQUESTS)
+        printf("Last %lld requests left out: not a full batch of %d\n",
+               n % NUM_REQUESTS, NUM_REQUESTS);
+    if (argc == 1) {
+        printf("Placed trace: ");
+        for (int i = 0; i < NUM_REQUESTS; i++)
+            printf("%d%s", placed[i], i < NUM_REQUESTS - 1 ? ", " : "\n");
+    }
+
+    printf("\n%-8s%12s%12s%12s%8s\n", "", "Original", "Placed", "Saved",
+           "%");
+    for (int a = 0; a < NUM_ALGS; a++) {
+        long long before = batch_movement((Algorithm)a, orig, n, start, dir);
+        long long after = batch_movement((Algorithm)a, placed, n, start, dir);
+        printf("%-8s%12lld%12lld%12lld%7.1f%%\n", ALG_NAMES[a], before,
+               after, before - after,
+               before ? 100.0 * (before - after) / before : 0.0);
+    }
+
+    free(keys);
+    free(orig);
+    free(placed);
+    addrmap_free(&m);
+    return 0;
+}
+
+/****************************************************************
+ * run_rearrange
+ * REARR mode: replays the trace with and without online hot-
+ * cylinder migration and reports, per algorithm, the net
+ * movement saved after the migration I/O is paid for.
+ ****************************************************************/
+int run_rearrange(int argc, char *argv[], int req[], int start,
+                  Direction dir) {
+    if (argc > 4) {
+        fprintf(stderr, "Usage: REARR [band] [half-life ms] [gap ms] "
+                        "[passes]\n");
+        return 1;
+    }
+
+    int band = argc > 0 ? atoi(argv[0]) : REARR_BAND;
+    double halfLife = argc > 1 ? atof(argv[1]) : REARR_HALF_LIFE;
+    double gap = argc > 2 ? atof(argv[2]) : SIM_GAP;
+    int passes = argc > 3 ? atoi(argv[3]) : SIM_PASSES;
+    if (band < 1 || band > MAX_BAND || halfLife <= 0 || gap <= 0
+        || passes < 1) {
+        fprintf(stderr, "ERROR: Invalid rearrangement configuration "
+                        "(band 1..%d).\n", MAX_BAND);
+        return 1;
+    }
+
+    DiskModel m = { SIM_SEEK_PER_CYL, SIM_SERVICE, 0, 0 };
+    printf("Band = %d cylinders around %d, half-life = %.1f ms, "
+           "gap = %.2f ms, passes = %d\n\n", band,
+           (NUM_CYLINDERS - 1) / 2, halfLife, gap, passes);
+    printf("%-8s%10s%10s%10s%8s%10s%10s%10s\n", "", "Base", "Rearr",
+           "Saved", "Moves", "Mig I/O", "Mean", "Mean'");
+
+    for (int a = 0; a < NUM_ONLINE_ALGS; a++) {
+        HeadState hs = { (Algorithm)a, start, dir, 0, NULL, 0 };
+        TraceReplay tr;
+        Rearranger ra;
+        SimStats base, moved;
+
+        Workload w = trace_workload(&tr, req, passes, gap);
+        simulate(&w, hs, &m, NULL, &base);
+
+        w = rearr_workload(&ra, trace_workload(&tr, req, passes, gap),
+                           band, halfLife);
+        simulate(&w, hs, &m, NULL, &moved);
+
+        printf("%-8s%10lld%10lld%+10lld%8d%10d%10.2f%10.2f\n",
+               ALG_NAMES[a], base.movement, moved.movement,
+               base.movement - moved.movement, ra.migrations,
+               moved.background, stats_mean(&base), stats_mean(&moved));
+
+        free(base.lat);
+        free(moved.lat);
+    }
+    return 0;
+}
+
+/****************************************************************
+ * run_defects
+ * DEFECT mode: ages a fleet of drives whose grown-defect count
+ * rises by `density` percent of the data cylinders per year,
+ * and reports the mean movement of each algorithm when it
+ * schedules by logical cylinder (remap-unaware) and by the
+ * resolved physical cylinder (remap-aware). Drives run on the
+ * work-stealing runtime, summed per worker and merged after.
+ ****************************************************************/
+#define DEFECT_YEARS  5
+#define DEFECT_DRIVES 1000
+#define DEFECT_GRAIN  16
+
+typedef struct {
+    // [year][aware][alg], year 0 is the healthy drive
+    _Alignas(CACHE_LINE) double s[DEFECT_YEARS + 1][2][NUM_ALGS];
+} DefectSums;
+
+typedef struct {
+    DefectKind kind;
+    double density;
+    int *req;
+    int start;
+    Direction dir;
+    const Result *healthy;
+    DefectSums *sums;   // one per worker
+} DefectFleet;
+
+void defect_body(void *ctx, long lo, long hi, int worker) {
+    DefectFleet *f = ctx;
+    double (*sums)[2][NUM_ALGS] = f->sums[worker].s;
+    RemapTable t;
+    int grown[DATA_DEFECTS];
+
+    for (long d = lo; d < hi; d++) {
+        unsigned long long rng = 0xDEFEC7ULL + d;
+        defect_order(f->kind, &rng, grown);
+
+        for (int y = 0; y <= DEFECT_YEARS; y++) {
+            int k = (int)(f->density / 100 * y * DATA_DEFECTS + 0.5);
+            remap_build(&t, grown, k < DATA_DEFECTS ? k : DATA_DEFECTS);
+
+            int phys[NUM_REQUESTS], physSorted[NUM_REQUESTS];
+            for (int i = 0; i < NUM_REQUESTS; i++)
+                phys[i] = remap_resolve(&t, f->req[i]);
+            memcpy(physSorted, phys, sizeof(phys));
+            qsort(physSorted, NUM_REQUESTS, sizeof(int), cmp_int);
+
+            for (int a = 0; a < NUM_ALGS; a++) {
+                sums[y][0][a] += remapped_movement(f->healthy[a].seq,
+                                                   f->healthy[a].len,
+                                                   f->start, &t);
+                sums[y][1][a] += run_algorithm((Algorithm)a, phys,
+                                               physSorted, f->start, f->dir)
+                                     .movement;
+            }
+        }
+    }
+}
+
+int run_defects(int argc, char *argv[], int req[], int start,
+                Direction dir) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: DEFECT <UNIFORM|CLUSTER> <density %%/year> "
+                        "[drives]\n");
+        return 1;
+    }
+
+    DefectKind kind;
+    if (strcmp(argv[0], "UNIFORM") == 0) kind = DEFECT_UNIFORM;
+    else if (strcmp(argv[0], "CLUSTER") == 0) kind = DEFECT_CLUSTER;
+    else {
+        fprintf(stderr, "ERROR: Defect kind must be UNIFORM or CLUSTER.\n");
+        return 1;
+    }
+
+    double density = atof(argv[1]);
+    int drives = argc > 2 ? atoi(argv[2]) : DEFECT_DRIVES;
+    if (density < 0 || density > 100 || drives < 1) {
+        fprintf(stderr, "ERROR: Invalid defect configuration.\n");
+        return 1;
+    }
+
+    int sorted[NUM_REQUESTS];
+    memcpy(sorted, req, sizeof(sorted));
+    qsort(sorted, NUM_REQUESTS, sizeof(int), cmp_int);
+
+    Result healthy[NUM_ALGS];
+    for (int a = 0; a < NUM_ALGS; a++)
+        healthy[a] = run_algorithm((Algorithm)a, req, sorted, start, dir);
+
+    static DefectSums perWorker[WS_MAX_WORKERS];
+    memset(perWorker, 0, sizeof(perWorker));
+    DefectFleet fleet = { kind, density, req, start, dir, healthy,
+                          perWorker };
+    ws_parallel_for(drives, DEFECT_GRAIN, defect_body, &fleet);
+
+    // integer movements, so the merged sums are exact in any order
+    static double sums[DEFECT_YEARS + 1][2][NUM_ALGS];
+    memset(sums, 0, sizeof(sums));
+    for (int w = 0; w < WS_MAX_WORKERS; w++)
+        for (int y = 0; y <= DEFECT_YEARS; y++)
+            for (int k = 0; k < 2; k++)
+                for (int a = 0; a < NUM_ALGS; a++)
+                    sums[y][k][a] += perWorker[w].s[y][k][a];
+
+    printf("Defects = %s, %.2f%% of %d data cylinders per year, "
+           "%d drives, spares on %d-%d\n", argv[0], density, DATA_DEFECTS,
+           drives, FIRST_SPARE, NUM_CYLINDERS - 1);
+
+    for (int aware = 0; aware < 2; aware++) {
+        printf("\n%s (mean movement):\n%-6s", aware ? "Remap-aware"
+                                                    : "Remap-unaware",
+               "Year");
+        for (int a = 0; a < NUM_ALGS; a++) printf("%9s", ALG_NAMES[a]);
+        printf("\n");
+
+        for (int y = 0; y <= DEFECT_YEARS; y++) {
+            printf("%-6d", y);
+            for (int a = 0; a < NUM_ALGS; a++)
+                printf("%9.1f", sums[y][aware][a] / drives);
+            printf("\n");
+        }
+    }
+    return 0;
+}
+
+/****************************************************************
+ * run_tier
+ * TIER mode: drives the SSD + HDD pair from a fio job file for
+ * cache sizes doubling from 1 MiB up to the given maximum and
+ * reports, per HDD scheduler, the read hit ratio, destage
+ * traffic and its head movement, and end-to-end latency.
+ ****************************************************************/
+int run_tier(int argc, char *argv[], int start, Direction dir) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: TIER <fio job file> <max cache MiB>\n");
+        return 1;
+    }
+
+    long long maxMib = atoll(argv[1]);
+    if (maxMib < 1 || maxMib > FIO_DISK_BYTES >> 20) {
+        fprintf(stderr, "ERROR: Cache size must be between 1 and %lld MiB.\n",
+                FIO_DISK_BYTES >> 20);
+        return 1;
+    }
+
+    static FioJob jobs[MAX_FIO_JOBS];
+    int n = parse_fio_file(argv[0], jobs, MAX_FIO_JOBS);
+    if (n < 0) return 1;
+    if (n == 0) {
+        fprintf(stderr, "ERROR: No jobs in %s.\n", argv[0]);
+        return 1;
+    }
+
+    DiskModel m = { SIM_SEEK_PER_CYL, SIM_SERVICE, 0, 0 };
+    printf("SSD tier: %lld KiB blocks, read %.2f ms, write %.2f ms, "
+           "destage above %.0f%% dirty or when idle\n", TIER_BLOCK / 1024,
+           SSD_READ_MS, SSD_WRITE_MS, 100 * TIER_DIRTY_HIGH);
+
+    for (int a = 0; a < NUM_ONLINE_ALGS; a++) {
+        printf("\n%s:\n%10s%8s%10s%12s%12s%9s%9s%9s\n", ALG_NAMES[a],
+               "Cache MiB", "Hit %", "Destages", "Dest. Move", "HDD Move",
+               "Mean", "P95", "P99");
+
+        for (long long mib = 1; ; mib = 2 * mib < maxMib ? 2 * mib : maxMib) {
+            HeadState hs = { (Algorithm)a, start, dir, 0, NULL, 0 };
+            FioWorkload fw;
+            SsdCache c;
+            SimStats st;
+
+            ssd_init(&c, (mib << 20) / TIER_BLOCK);
+            Workload w = fio_workload(&fw, jobs, n);
+            simulate_tiered(&w, hs, &m, &c, &st);
+
+            printf("%10lld%8.1f%10lld%12lld%12lld%9.2f%9.2f%9.2f\n", mib,
+                   c.reads ? 100.0 * c.hits / c.reads : 0.0, c.destages,
+                   st.bgMovement, st.movement, stats_mean(&st),
+                   stats_percentile(&st, 95), stats_percentile(&st, 99));
+
+            ssd_free(&c);
+            fio_free(&fw);
+            free(st.lat);
+            if (mib == maxMib) break;
+        }
+    }
+    return 0;
+}
+
+/****************************************************************
+ * run_tape
+ * TAPE mode: a recall batch of uniformly random blocks on a
+ * serpentine tape loaded at BOT, served by each tape scheduler,
+ * with total and mean locate time.
+ ****************************************************************/
+#define MAX_TAPE_BATCH 20000
+
+int run_tape(int argc, char *argv[]) {
+    if (argc < 1 || argc > 2) {
+        fprintf(stderr, "Usage: TAPE <batch size> [seed]\n");
+        return 1;
+    }
+
+    int n = atoi(argv[0]);
+    unsigned long long rng = argc > 1 ? strtoull(argv[1], NULL, 10) : 1;
+    if (n < 1 || n > MAX_TAPE_BATCH) {
+        fprintf(stderr, "ERROR: Batch size must be between 1 and %d.\n",
+                MAX_TAPE_BATCH);
+        return 1;
+    }
+
+    long long *blocks = malloc(n * sizeof(long long));
+    int *order = malloc(n * sizeof(int));
+    for (int i = 0; i < n; i++)
+        blocks[i] = (long long)(rng_next(&rng)
+                                % (TAPE_WRAPS * TAPE_BLOCKS_PER_WRAP));
+
+    TapePos bot = { 0, 0, 1 };
+    printf("Tape: %d wraps in %d bands, %.0f m, locate %.1f m/s, "
+           "reversal %.1f s, wrap switch %.1f s (+%.1f s across bands)\n",
+           TAPE_WRAPS, TAPE_BANDS, TAPE_LENGTH_M, TAPE_LOCATE_MPS,
+           TAPE_REVERSE_S, TAPE_WRAP_SWITCH_S, TAPE_BAND_SWITCH_S);
+    printf("Recall batch = %d blocks\n\n", n);
+    printf("%-10s%12s%12s%10s\n", "", "Locate (h)", "Mean (s)", "Saved");
+
+    double fifo = 0;
+    for (int a = 0; a < NUM_TAPE_ALGS; a++) {
+        tape_schedule((TapeAlgorithm)a, blocks, n, bot, order);
+        double cost = tape_order_cost(blocks, order, n, bot);
+        if (a == TAPE_FIFO) fifo = cost;
+        printf("%-10s%12.2f%12.2f%9.1f%%\n", TAPE_NAMES[a], cost / 3600,
+               cost / n, fifo > 0 ? 100 * (fifo - cost) / fifo : 0.0);
+    }
+
+    free(blocks);
+    free(order);
+    return 0;
+}
+
+/****************************************************************
+ * run_surfaces
+ * SURFACE mode: replays the trace with requests spread over
+ * NUM_SURFACES surfaces and head switches costing
+ * HEAD_SWITCH_MS, served surface-blind (earliest arrival within
+ * a cylinder) and surface-aware (surface_order, and SSTF by
+ * modelled access time). The default gap keeps a queue deep
+ * enough for several requests to share a cylinder.
+ ****************************************************************/
+#define SURFACE_GAP 2.5
+
+int run_surfaces(int argc, char *argv[], int req[], int start,
+                 Direction dir) {
+    if (argc > 3) {
+        fprintf(stderr, "Usage: SURFACE [switch ms] [gap ms] [passes]\n");
+        return 1;
+    }
+
+    double sw = argc > 0 ? atof(argv[0]) : HEAD_SWITCH_MS;
+    double gap = argc > 1 ? atof(argv[1]) : SURFACE_GAP;
+    int passes = argc > 2 ? atoi(argv[2]) : SIM_PASSES;
+    if (sw <= 0 || gap <= 0 || passes < 1) {
+        fprintf(stderr, "ERROR: Invalid surface configuration.\n");
+        return 1;
+    }
+
+    DiskModel m = { SIM_SEEK_PER_CYL, SIM_SERVICE, 0, sw };
+    printf("%d surfaces, head switch = %.2f ms, gap = %.2f ms, "
+           "passes = %d\n\n", NUM_SURFACES, sw, gap, passes);
+    printf("%-8s%12s%10s%10s%12s%10s%10s\n", "", "Blind IOPS", "Mean",
+           "P95", "Aware IOPS", "Mean", "P95");
+
+    for (int a = 0; a < NUM_ONLINE_ALGS; a++) {
+        SimStats st[2];
+        for (int aware = 0; aware < 2; aware++) {
+            HeadState hs = { (Algorithm)a, start, dir, 0,
+                             aware ? &m : NULL, 0 };
+            TraceReplay tr;
+            Workload w = trace_workload(&tr, req, passes, gap);
+            tr.surfaces = NUM_SURFACES;
+            simulate(&w, hs, &m, NULL, &st[aware]);
+        }
+
+        printf("%-8s", ALG_NAMES[a]);
+        for (int aware = 0; aware < 2; aware++) {
+            printf("%12.1f%10.2f%10.2f", 1000.0 * st[aware].n / st[aware].end,
+                   stats_mean(&st[aware]), stats_percentile(&st[aware], 95));
+            free(st[aware].lat);
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
+/****************************************************************
+ * run_submit
+ * SUBMIT mode: P producer threads each submit `each` trace
+ * requests through their ring while the main thread drains the
+ * rings and dispatches with the chosen algorithm, keeping at most
+ * SUBMIT_DEPTH requests queued. Reports wall-clock submission
+ * and dispatch rates.
+ ****************************************************************/
+#define SUBMIT_EACH  1000000
+#define SUBMIT_DEPTH 64
+#define MAX_PRODUCERS 256
+
+typedef struct {
+    SubmitQueue *q;
+    int id;
+    long long each;
+    const int *req;
+    long long fullRetries;
+    atomic_int *finished;
+} Producer;
+
+void *producer_main(void *arg) {
+    Producer *p = arg;
+    IoRequest r;
+    memset(&r, 0, sizeof(r));
+    r.dep = -1;
+    r.sectors = SIM_SECTORS;
+    r.tag = p->id;
+
+    for (long long i = 0; i < p->each; i++) {
+        r.cyl = p->req[(p->id + i) % NUM_REQUESTS];
+        while (!submit(p->q, p->id, &r)) {
+            p->fullRetries++;
+            sched_yield();
+        }
+    }
+    atomic_fetch_add_explicit(p->finished, 1, memory_order_release);
+    return NULL;
+}
+
+double wall_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int run_submit(int argc, char *argv[], int req[], int start,
+               Direction dir) {
+    if (argc < 1 || argc > 3) {
+        fprintf(stderr, "Usage: SUBMIT <producers> [requests per producer] "
+                        "[algorithm]\n");
+        return 1;
+    }
+
+    int producers = atoi(argv[0]);
+    long long each = argc > 1 ? atoll(argv[1]) : SUBMIT_EACH;
+    int alg = ALG_CLOOK;
+    if (argc > 2)
+        for (alg = 0; alg < NUM_ALGS; alg++)
+            if (strcmp(argv[2], ALG_NAMES[alg]) == 0) break;
+    if (producers < 1 || producers > MAX_PRODUCERS || each < 1
+        || alg == NUM_ALGS) {
+        fprintf(stderr, "ERROR: Invalid submission configuration "
+                        "(1..%d producers, FCFS..C-LOOK).\n", MAX_PRODUCERS);
+        return 1;
+    }
+
+    SubmitQueue q;
+    if (!submit_init(&q, producers)) {
+        fprintf(stderr, "ERROR: Cannot allocate %d submission rings.\n",
+                producers);
+        return 1;
+    }
+    HeadState hs = { (Algorithm)alg, start, dir, 0, NULL, 0 };
+    OnlineSched s;
+    sched_init(&s, hs);
+
+    Producer *prod = calloc(producers, sizeof(Producer));
+    pthread_t *tid = malloc(producers * sizeof(pthread_t));
+    if (!prod || !tid) {
+        fprintf(stderr, "ERROR: Cannot allocate %d producers.\n",
+                producers);
+        free(prod);
+        free(tid);
+        sched_free(&s);
+        submit_free(&q);
+        return 1;
+    }
+    atomic_int finished;
+    atomic_init(&finished, 0);
+
+    // The main thread has to drain, so a producer that fails to start
+    // cannot run inline; carry on with the ones that did.
+    double t0 = wall_seconds();
+    int started = 0;
+    for (; started < producers; started++) {
+        Producer *p = &prod[started];
+        p->q = &q;
+        p->id = started;
+        p->each = each;
+        p->req = req;
+        p->finished = &finished;
+        if (pthread_create(&tid[started], NULL, producer_main, p) != 0)
+            break;
+    }
+    int requested = producers;
+    producers = started;
+    if (producers == 0) {
+        fprintf(stderr, "ERROR: Cannot start producer threads.\n");
+        free(prod);
+        free(tid);
+        sched_free(&s);
+        submit_free(&q);
+        return 1;
+    }
+
+    long long drained = 0, drains = 0, dispatched = 0, movement = 0;
+    for (;;) {
+        int done = atomic_load_explicit(&finished, memory_order_acquire)
+                   == producers;
+        int n = submit_drain(&q, &s);
+        drained += n;
+        if (n) drains++;
+
+        while (sched_len(&s) > (done && !n ? 0 : SUBMIT_DEPTH)) {
+            int travel = 0;
+            sched_next(&s, 0, &travel);
+            movement += travel;
+            dispatched++;
+        }
+        if (done && !n && sched_len(&s) == 0) break;
+        if (!n) sched_yield();   // let producers run on busy cores
+    }
+    double elapsed = wall_seconds() - t0;
+
+    long long retries = 0;
+    for (int p = 0; p < producers; p++) {
+        pthread_join(tid[p], NULL);
+        retries += prod[p].fullRetries;
+    }
+
+    printf("Producers = %d", producers);
+    if (producers < requested) printf(" (of %d requested)", requested);
+    printf(", %lld requests each, %s, ring = %d slots, batch = %d\n\n",
+           each, ALG_NAMES[alg], RING_SLOTS, RING_BATCH);
+    printf("Submitted        %12lld\n", drained);
+    printf("Dispatched       %12lld\n", dispatched);
+    printf("Elapsed (s)      %12.3f\n", elapsed);
+    printf("Submissions/s    %12.0f\n", elapsed > 0 ? drained / elapsed : 0);
+    printf("Mean drain batch %12.1f\n", drains ? (double)drained / drains : 0);
+    printf("Ring-full waits  %12lld\n", retries);
+    printf("Head movement    %12lld\n", movement);
+
+    free(prod);
+    free(tid);
+    sched_free(&s);
+    submit_free(&q);
+    return 0;
+}
+
+/****************************************************************
+ * Miss counters
+ * Count user-mode events of this thread and of the threads it
+ * creates afterwards (perf_event_open with inherit; a worker's
+ * counts fold in when it is joined): data-TLB load misses or
+ * last-level cache misses. perf_counter_open returns -1 when
+ * perf events are unavailable, e.g. in containers or with
+ * kernel.perf_event_paranoid > 2.
+ ****************************************************************/
+#define PERF_DTLB_MISSES (PERF_COUNT_HW_CACHE_DTLB \
+                          | (PERF_COUNT_HW_CACHE_OP_READ << 8) \
+                          | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+int perf_counter_open(unsigned type, unsigned long long config) {
+    struct perf_event_attr a;
+    memset(&a, 0, sizeof(a));
+    a.size = sizeof(a);
+    a.type = type;
+    a.config = config;
+    a.disabled = 1;
+    a.inherit = 1;
+    a.exclude_kernel = 1;
+    a.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &a, 0, -1, -1, 0);
+}
+
+void perf_counter_start(int fd) {
+    if (fd < 0) return;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+/* Events since perf_counter_start, or -1 without a counter. */
+long long perf_counter_stop(int fd) {
+    long long count;
+    if (fd < 0) return -1;
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    return read(fd, &count, sizeof(count)) == sizeof(count) ? count : -1;
+}
+
+/****************************************************************
+ * run_bench
+ * BENCH mode: a synthetic trace of `requests` cylinders on a
+ * disk of BENCH_CYLINDERS, its SortedReq array (built by
+ * counting sort) and `queries` random lookups on the
+ * work-stealing runtime. A lookup locates request k in sweep
+ * order by binary search on (cylinder, index), then reads its
+ * FCFS successor and its LOOK successor - a random walk of
+ * about log2(requests) pages, so it is bound by TLB reach.
+ * Each row places the two arrays differently:
+ *   LOCAL       first-touched by the main thread, unpinned
+ *   INTERLEAVE  chunks spread over the nodes, workers pinned
+ *   REPLICATE   one copy per node, each worker reads its own
+ * and reports lookups/s and dTLB misses per lookup.
+ *
+ * It then measures the CylQueue prefetch distance: a queue of
+ * `depth` requests (default 10^7) is drained by SSTF, C-LOOK and
+ * FCFS at each distance in BENCH_DISTANCES, reporting
+ * dispatches/s and last-level cache misses per dispatch, and the
+ * fastest distance per policy. The simulator applies
+ * DISK_SCHED_PREFETCH to the bucket-draining policies only.
+ ****************************************************************/
+#define BENCH_REQUESTS  (1L << 25)
+#define BENCH_QUERIES   (1L << 20)
+#define BENCH_DEPTH     10000000L
+#define BENCH_CYLINDERS 100000
+#define BENCH_GRAIN     4096
+
+typedef enum { BENCH_LOCAL, BENCH_INTERLEAVE, BENCH_REPLICATE,
+               NUM_BENCH_PLACEMENTS } BenchPlacement;
+
+const char *PAGE_NAMES[NUM_PAGE_KINDS] = { "4K", "THP", "HUGETLB" };
+const char *BENCH_PLACEMENT_NAMES[NUM_BENCH_PLACEMENTS] = {
+    "LOCAL", "INTERLEAVE", "REPLICATE"
+};
+
+typedef struct {
+    _Alignas(CACHE_LINE) long long sum;
+} BenchSum;
+
+typedef struct {
+    const int *req[MAX_NODES];          // per node (shared unless replicated)
+    const SortedReq *sorted[MAX_NODES];
+    const NumaTopology *topo;
+    long n;
+    BenchSum *sums;                     // per worker
+} BenchArrays;
+
+/* Position of request k in sweep order. */
+long bench_locate(const SortedReq s[], long n, int cyl, long k) {
+    long lo = 0, hi = n;
+    while (lo < hi) {
+        long mid = lo + (hi - lo) / 2;
+        if (s[mid].cyl < cyl || (s[mid].cyl == cyl && s[mid].idx < k))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+void bench_body(void *ctx, long lo, long hi, int worker) {
+    BenchArrays *a = ctx;
+    int node = numa_worker_node(a->topo, worker);
+    const int *req = a->req[node];
+    const SortedReq *s = a->sorted[node];
+    long long sum = 0;
+
+    for (long q = lo; q < hi; q++) {
+        unsigned long long h = 0xBE7CULL + (unsigned long long)q;
+        long k = (long)(rng_next(&h) % (unsigned long long)(a->n - 1));
+        long pos = bench_locate(s, a->n, req[k], k);
+        sum += abs(req[k + 1] - req[k]);
+        if (pos + 1 < a->n) sum += s[pos + 1].cyl - req[k];
+    }
+    a->sums[worker].sum += sum;
+}
+
+const int BENCH_DISTANCES[] = { 0, 2, 4, 8, 16, 32, 64 };
+
+/* Seconds to drain depth random requests; *misses from fd. */
+double bench_drain(long depth, HeadState hs, int dist, int fd,
+                   long long *misses) {
+    OnlineSched s;
+    sched_init(&s, hs);
+    cylq_set_prefetch(&s.q, dist);
+
+    IoRequest r;
+    memset(&r, 0, sizeof(r));
+    r.dep = -1;
+    r.sectors = SIM_SECTORS;
+    unsigned long long rng = 0xD7A1ULL;
+    for (long i = 0; i < depth; i++) {
+        r.cyl = (int)(rng_next(&rng) % NUM_CYLINDERS);
+        sched_push(&s, r);
+    }
+
+    perf_counter_start(fd);
+    double t0 = wall_seconds();
+    while (sched_len(&s) > 0) {
+        int travel = 0;
+        sched_next(&s, 0, &travel);
+    }
+    double elapsed = wall_seconds() - t0;
+    *misses = perf_counter_stop(fd);
+
+    sched_free(&s);
+    return elapsed;
+}
+
+#define BENCH_ALGS 3
+
+void bench_queue(long depth, int start, Direction dir) {
+    const Algorithm algs[BENCH_ALGS] = { ALG_SSTF, ALG_CLOOK, ALG_FCFS };
+    int fd = perf_counter_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    int ndist = sizeof(BENCH_DISTANCES) / sizeof(BENCH_DISTANCES[0]);
+    int best[BENCH_ALGS] = { 0 };
+    double bestTime[BENCH_ALGS];
+    for (int a = 0; a < BENCH_ALGS; a++) bestTime[a] = INFINITY;
+
+    printf("\nQueue depth = %ld, prefetch distance in bucket links\n\n",
+           depth);
+    printf("%8s", "Distance");
+    for (int a = 0; a < BENCH_ALGS; a++)
+        printf("  %6s Mdisp/s  misses/disp", ALG_NAMES[algs[a]]);
+    printf("\n");
+
+    for (int d = 0; d < ndist; d++) {
+        printf("%8d", BENCH_DISTANCES[d]);
+        for (int a = 0; a < BENCH_ALGS; a++) {
+            HeadState hs = { algs[a], start, dir, 0, NULL, 0 };
+            long long misses;
+            double t = bench_drain(depth, hs, BENCH_DISTANCES[d], fd,
+                                   &misses);
+            if (t < bestTime[a]) {
+                bestTime[a] = t;
+                best[a] = BENCH_DISTANCES[d];
+            }
+            printf("  %14.2f", t > 0 ? depth / t / 1e6 : 0);
+            if (misses < 0) printf("  %11s", "n/a");
+            else printf("  %11.2f", (double)misses / depth);
+        }
+        printf("\n");
+    }
+
+    printf("\nFastest distance:");
+    for (int a = 0; a < BENCH_ALGS; a++)
+        printf(" %s %d%s", ALG_NAMES[algs[a]], best[a],
+               a < BENCH_ALGS - 1 ? "," : ".\n");
+    printf("Bucket-draining policies use DISK_SCHED_PREFETCH (current %d); "
+           "FCFS and KYBER never prefetch.\n", prefetch_distance());
+    if (fd >= 0) close(fd);
+}
+
+int run_bench(int argc, char *argv[], int start, Direction dir) {
+    if (argc > 3) {
+        fprintf(stderr, "Usage: BENCH [requests] [queries] [queue depth]\n");
+        return 1;
+    }
+
+    long n = argc > 0 ? atol(argv[0]) : BENCH_REQUESTS;
+    long queries = argc > 1 ? atol(argv[1]) : BENCH_QUERIES;
+    long depth = argc > 2 ? atol(argv[2]) : BENCH_DEPTH;
+    if (n < 2 || n > INT_MAX || queries < 1 || depth < 0
+        || depth > INT_MAX / 2) {
+        fprintf(stderr, "ERROR: BENCH needs 2..%d requests, at least "
+                        "one query and a queue depth of 0..%d.\n",
+                INT_MAX, INT_MAX / 2);
+        return 1;
+    }
+
+    NumaTopology topo;
+    numa_discover(&topo);
+    int workers = ws_workers();
+    size_t reqBytes = n * sizeof(int), sortedBytes = n * sizeof(SortedReq);
+
+    // master copies, from which every placement is filled
+    int *req = malloc(reqBytes);
+    SortedReq *sorted = malloc(sortedBytes);
+    long *bucket = calloc(BENCH_CYLINDERS + 1, sizeof(long));
+    if (!req || !sorted || !bucket) {
+        fprintf(stderr, "ERROR: Cannot allocate %ld requests.\n", n);
+        free(req);
+        free(sorted);
+        free(bucket);
+        return 1;
+    }
+    unsigned long long rng = 0xB16B00B5ULL;
+    for (long i = 0; i < n; i++) {
+        req[i] = (int)(rng_next(&rng) % BENCH_CYLINDERS);
+        bucket[req[i] + 1]++;
+    }
+    for (int c = 0; c < BENCH_CYLINDERS; c++) bucket[c + 1] += bucket[c];
+    for (long i = 0; i < n; i++) {
+        long at = bucket[req[i]]++;
+        sorted[at].cyl = req[i];
+        sorted[at].idx = (int)i;
+    }
+    free(bucket);
+
+    int fd = perf_counter_open(PERF_TYPE_HW_CACHE, PERF_DTLB_MISSES);
+    printf("Requests = %ld (%.0f MiB of req + sorted), queries = %ld, "
+           "workers = %d, nodes = %d\n\n", n,
+           (reqBytes + sortedBytes) / 1048576.0, queries, workers,
+           topo.nodes);
+    printf("%-8s %-11s %-6s %9s %12s %16s\n", "Pages", "Placement",
+           "Pinned", "Time (s)", "Mlookups/s", "dTLB miss/lookup");
+
+    const struct { PageKind pages; BenchPlacement place; } ROWS[] = {
+        { PAGES_SMALL, BENCH_LOCAL },
+        { PAGES_THP, BENCH_LOCAL },
+        { PAGES_HUGETLB, BENCH_LOCAL },
+        { PAGES_SMALL, BENCH_INTERLEAVE },
+        { PAGES_THP, BENCH_INTERLEAVE },
+        { PAGES_SMALL, BENCH_REPLICATE },
+        { PAGES_THP, BENCH_REPLICATE },
+    };
+    long long expected = -1;
+    int mismatch = 0;
+
+    for (size_t row = 0; row < sizeof(ROWS) / sizeof(ROWS[0]); row++) {
+        PageKind pages = ROWS[row].pages;
+        BenchPlacement place = ROWS[row].place;
+        void *reqCopy[MAX_NODES] = { 0 }, *sortedCopy[MAX_NODES] = { 0 };
+        int copies = place == BENCH_REPLICATE ? topo.nodes : 1;
+        int ok;
+
+        if (place == BENCH_REPLICATE) {
+            ok = big_replicate(&topo, req, reqBytes, pages, reqCopy);
+            if (ok && !big_replicate(&topo, sorted, sortedBytes, pages,
+                                     sortedCopy)) {
+                for (int k = 0; k < copies; k++)
+                    big_free(reqCopy[k], reqBytes);
+                ok = 0;
+            }
+        } else if (place == BENCH_INTERLEAVE) {
+            reqCopy[0] = big_interleave(&topo, req, reqBytes, pages);
+            sortedCopy[0] = big_interleave(&topo, sorted, sortedBytes, pages);
+            ok = reqCopy[0] && sortedCopy[0];
+        } else {
+            reqCopy[0] = big_alloc(reqBytes, pages);
+            sortedCopy[0] = big_alloc(sortedBytes, pages);
+            ok = reqCopy[0] && sortedCopy[0];
+            if (ok) {
+                memcpy(reqCopy[0], req, reqBytes);
+                memcpy(sortedCopy[0], sorted, sortedBytes);
+            }
+        }
+        printf("%-8s %-11s %-6s ", PAGE_NAMES[pages],
+               BENCH_PLACEMENT_NAMES[place],
+               place == BENCH_LOCAL ? "no" : "yes");
+        if (!ok) {
+            if (copies == 1) {
+                big_free(reqCopy[0], reqBytes);
+                big_free(sortedCopy[0], sortedBytes);
+            }
+            printf("%9s   (mapping failed%s)\n", "-",
+                   pages == PAGES_HUGETLB ? "; reserve vm.nr_hugepages" : "");
+            continue;
+        }
+
+        BenchArrays a;
+        a.sums = cache_alloc(workers * sizeof(BenchSum));
+        if (!a.sums) {
+            for (int k = 0; k < copies; k++) {
+                big_free(reqCopy[k], reqBytes);
+                big_free(sortedCopy[k], sortedBytes);
+            }
+            printf("%9s   (out of memory)\n", "-");
+            continue;
+        }
+        memset(a.sums, 0, workers * sizeof(BenchSum));
+        a.topo = &topo;
+        a.n = n;
+        for (int k = 0; k < topo.nodes; k++) {
+            a.req[k] = reqCopy[copies == 1 ? 0 : k];
+            a.sorted[k] = sortedCopy[copies == 1 ? 0 : k];
+        }
+
+        perf_counter_start(fd);
+        double t0 = wall_seconds();
+        ws_parallel_for_on(queries, BENCH_GRAIN, bench_body, &a,
+                           place == BENCH_LOCAL ? NULL : &topo);
+        double elapsed = wall_seconds() - t0;
+        long long misses = perf_counter_stop(fd);
+
+        long long sum = 0;
+        for (int w = 0; w < workers; w++) sum += a.sums[w].sum;
+        if (expected < 0) expected = sum;
+        else if (sum != expected) mismatch = 1;
+
+        printf("%9.3f %12.2f ", elapsed,
+               elapsed > 0 ? queries / elapsed / 1e6 : 0);
+        if (misses < 0) printf("%16s\n", "n/a");
+        else printf("%16.2f\n", (double)misses / queries);
+
+        free(a.sums);
+        for (int k = 0; k < copies; k++) {
+            big_free(reqCopy[k], reqBytes);
+            big_free(sortedCopy[k], sortedBytes);
+        }
+    }
+
+    printf("\nChecksum %lld%s\n", expected,
+           mismatch ? " (MISMATCH across placements)" : "");
+    if (fd < 0)
+        printf("dTLB counts need perf events "
+               "(kernel.perf_event_paranoid <= 2).\n");
+    else
+        close(fd);
+    free(req);
+    free(sorted);
+
+    if (depth > 0) bench_queue(depth, start, dir);
+    return 0;
+}
+
+/****************************************************************
+ * run_mode
+ * Dispatches the optional MODE argument to its analysis.
+ ****************************************************************/
+int run_mode(int argc, char *argv[], int req[], int start,
+             Direction dir) {
+    if (strcmp(argv[0], "WINDOW") == 0)
+        return run_window(argc - 1, argv + 1, req, start, dir);
+    if (strcmp(argv[0], "SLIDE") == 0)
+        return run_slide(argc - 1, argv + 1, req, start, dir);
+    if (strcmp(argv[0], "VR") == 0)
+        return run_continuum(argc - 1, argv + 1, req, start, dir);
+    if (strcmp(argv[0], "BEAM") == 0)
+        return run_beam(argc - 1, argv + 1, req, start);
+    if (strcmp(argv[0], "ANNEAL") == 0)
+        return run_anneal(argc - 1, argv + 1, req, start);
+    if (strcmp(argv[0], "ORDER") == 0)
+        return run_ordering(argc - 1, argv + 1, req, start, dir);
+    if (strcmp(argv[0], "BG") == 0)
+        return run_background(argc - 1, argv + 1, req, start, dir);
+    if (strcmp(argv[0], "CLOSED") == 0)
+        return run_closed(argc - 1, argv + 1, req, start, dir);
+    if (strcmp(argv[0], "FIO") == 0)
+        return run_fio(argc - 1, argv + 1, start, dir);
+    if (strcmp(argv[0], "BLKMQ") == 0)
+        return run_blkmq(argc - 1, argv + 1);
+    if (strcmp(argv[0], "ZBR") == 0)
+        return run_zbr(argc - 1, argv + 1, req, start, dir);
+    if (strcmp(argv[0], "PLACE") == 0)
+        return run_place(argc - 1, argv + 1, req, start, dir);
+    if (strcmp(argv[0], "REARR") == 0)
+        return run_rearrange(argc - 1, argv + 1, req, start, dir);
+    if (strcmp(argv[0], "DEFECT") == 0)
+        return run_defects(argc - 1, argv + 1, req, start, dir);
+    if (strcmp(argv[0], "TIER") == 0)
+        return run_tier(argc - 1, argv + 1, start, dir);
+    if (strcmp(argv[0], "TAPE") == 0)
+        return run_tape(argc - 1, argv + 1);
+    if (strcmp(argv[0], "SURFACE") == 0)
+        return run_surfaces(argc - 1, argv + 1, req, start, dir);
+    if (strcmp(argv[0], "SUBMIT") == 0)
+        return run_submit(argc - 1, argv + 1, req, start, dir);
+    if (strcmp(argv[0], "BENCH") == 0)
+        return run_bench(argc - 1, argv + 1, start, dir);
+
+    fprintf(stderr, "ERROR: Unknown mode %s.\n", argv[0]);
+    return 1;
+}
+
+/****************************************************************
+ * main
+ * Coordinates:
+ *    argument parsing
+ *    file I/O for request.bin
+ *    sorting (or loading the cached sorted sidecar)
+ *    invocation of all algorithms, or of the selected mode
+ ****************************************************************/
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr,
+                "Usage: ./A4Q1 <initial> <LEFT|RIGHT> [MODE args...]\n");
+        return 1;
+    }
+
+    int start = atoi(argv[1]);
+    if (start < 0 || start >= NUM_CYLINDERS) {
+        fprintf(stderr, "ERROR: Initial head must be between 0 and 299.\n");
+        return 1;
+    }
+
+    Direction dir = parse_direction(argv[2]);
+
+    int req[NUM_REQUESTS];
+    FILE *fp = fopen("request.bin", "rb");
+    if (!fp) {
+        perror("ERROR opening request.bin");
+        return 1;
+    }
+
+    if (fread(req, sizeof(int), NUM_REQUESTS, fp) != NUM_REQUESTS) {
+        fprintf(stderr, "ERROR: Could not read all requests.\n");
+        return 1;
+    }
+    fclose(fp);
+
+    // DISK_SCHED_CACHE names a directory for the sidecar and results
+    int sorted[NUM_REQUESTS];
+    const char *cacheDir = getenv("DISK_SCHED_CACHE");
+    unsigned long long hash = trace_hash(req);
+
+    if (!cacheDir || !load_sorted_sidecar(cacheDir, hash, sorted)) {
+        memcpy(sorted, req, sizeof(req));
+        qsort(sorted, NUM_REQUESTS, sizeof(int), cmp_int);
+        if (cacheDir)
+            save_sorted_sidecar(cacheDir, hash, sorted);
+    }
+
+    printf("Total requests = %d\n", NUM_REQUESTS);
+    printf("Initial Head Position: %d\n", start);
+    printf("Direction of Head: %s\n\n",
+           dir == DIR_LEFT ? "LEFT" : "RIGHT");
+
+    if (argc > 3)
+        return run_mode(argc - 3, argv + 3, req, start, dir);
+
+    ResultCache cache;
+    if (cacheDir) cache_open(&cache, cacheDir);
 
-    print_result("FCFS",   schedule_fcfs(req, start));
-    print_result("SSTF",   schedule_sstf(req, start));
-    print_result("SCAN",   schedule_scan(sorted, start, dir));
-    print_result("C-SCAN", schedule_cscan(sorted, start, dir));
-    print_result("LOOK",   schedule_look(sorted, start, dir));
-    print_result("C-LOOK", schedule_clook(sorted, start, dir));
+    for (int a = 0; a < NUM_ALGS; a++)
+        print_result(ALG_NAMES[a],
+                     cached_run(cacheDir ? &cache : NULL, hash,
+                                (Algorithm)a, req, sorted, start, dir));
 
+    if (cacheDir) cache_close(&cache);
     return 0;
 }
 